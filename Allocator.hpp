@@ -9,48 +9,522 @@
 // includes
 // --------
 
-#include <cassert>   // assert
-#include <cstddef>   // ptrdiff_t, size_t
-#include <new>       // bad_alloc, new
-#include <stdexcept> // invalid_argument
+#include <algorithm>   // fill, max, min, sort
+#include <array>       // array
+#include <atomic>      // atomic, atomic_ref
+#include <bit>         // bit_width, countl_zero, countr_zero
+#include <cassert>     // assert
+#include <cerrno>      // EEXIST, EOWNERDEAD, errno, EWOULDBLOCK
+#include <chrono>      // steady_clock
+#include <compare>     // compare_three_way, strong_ordering
+#include <climits>     // INT_MAX, INT_MIN
+#include <cstddef>     // ptrdiff_t, size_t
+#include <cstdint>     // intptr_t, uint16_t, uint32_t, uint64_t, uintptr_t
+#include <cstdio>      // fclose, FILE, fopen, fwrite, remove, rename
+#include <cstdlib>     // abs
+#include <cstring>     // memcmp, memcpy
+#include <iterator>    // random_access_iterator_tag
+#include <limits>      // numeric_limits
+#include <memory>      // addressof, make_shared, make_unique, pointer_traits, shared_ptr, to_address, unique_ptr
+#include <memory_resource> // pmr::memory_resource
+#include <span>        // span
+#include <mutex>       // lock_guard, mutex
+#include <new>         // bad_alloc, new
+#include <stdexcept>   // invalid_argument, length_error, logic_error, runtime_error
+#include <string>      // string
+#include <thread>      // this_thread
+#include <type_traits> // add_lvalue_reference_t, is_convertible_v, is_same_v, remove_cv_t
+#include <typeinfo>    // typeid
+#include <unordered_map> // unordered_map
+#include <utility>     // move, move_if_noexcept, pair
+#include <vector>      // vector
 
-// ------------
-// My_Allocator
-// ------------
+#include <fcntl.h>     // open
+#include <pthread.h>   // pthread_mutex_consistent, pthread_mutex_lock, pthread_mutex_unlock
+#include <sys/file.h>  // flock
+#include <sys/mman.h>  // madvise, mmap, msync, munmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close, ftruncate, pread, pwrite, sysconf
+
+// ------------------
+// placement policies
+// ------------------
+
+/**
+ * the lowest free block that fits
+ */
+struct First_Fit {};
+
+/**
+ * the first free block that fits at or after the previous allocation,
+ * wrapping around to the lowest one
+ */
+struct Next_Fit {};
+
+/**
+ * the smallest of the first K free blocks that fit, smallest size class first
+ */
+template <int K>
+struct Good_Fit {
+    static_assert(K > 0, "Good_Fit needs at least one candidate");
+    static constexpr int candidates = K;
+};
+
+/**
+ * the smallest free block that fits
+ */
+struct Best_Fit : Good_Fit<INT_MAX> {};
+
+// ------
+// layout
+// ------
+
+/**
+ * the placement of Policy, on the compact layout: a busy block keeps only
+ * its header, with a bit for whether the block before it is free, and only
+ * a free block has a footer, which is all coalescing looks at
+ */
+template <typename Policy>
+struct Compact : Policy {
+    using placement = Policy;
+};
+
+/**
+ * the placement and layout of Policy, hardened: a busy block ends in a
+ * canary, checked when it is freed, and a freed block is poisoned and kept
+ * busy in a quarantine of the last Quarantine blocks freed, so that its
+ * bytes aren't reused until Quarantine more blocks are freed
+ * Compact, Hardened, Wide, and Relocatable nest in any order
+ */
+template <typename Policy, std::size_t Quarantine = 16>
+struct Hardened : Policy {
+    using placement = Policy;
+};
+
+/**
+ * the placement and layout of Policy, with 64-bit sentinels, links, and
+ * indices, for heaps of 2 GiB or more, whose sizes don't fit in an int
+ * the sign of a sentinel still says whether its block is busy
+ */
+template <typename Policy>
+struct Wide : Policy {
+    using placement = Policy;
+};
+
+/**
+ * the placement and layout of Policy, for containers whose nodes are in
+ * the heap: My_Allocator's pointers are offset_ptrs, and it keeps an
+ * offset_ptr to its heap instead of sharing it, so that a container that
+ * is itself in the heap stays valid wherever the heap is loaded or mapped
+ */
+template <typename Policy>
+struct Relocatable : Policy {
+    using placement = Policy;
+};
+
+/**
+ * the placement policy of P, whether it asks for the compact layout,
+ * whether it asks to be hardened, with a quarantine of how many blocks,
+ * the type of its sentinels, and whether its allocators are relocatable
+ */
+template <typename P>
+struct Layout_Of {
+    using placement = P;
+    using tag_type  = int;
+    static constexpr bool        compact     = false;
+    static constexpr bool        hardened    = false;
+    static constexpr std::size_t quarantine  = 0;
+    static constexpr bool        relocatable = false;
+};
+
+template <typename P>
+struct Layout_Of<Compact<P>> : Layout_Of<P> {
+    static constexpr bool compact = true;
+};
+
+template <typename P, std::size_t Q>
+struct Layout_Of<Hardened<P, Q>> : Layout_Of<P> {
+    static constexpr bool        hardened   = true;
+    static constexpr std::size_t quarantine = Q;
+};
+
+template <typename P>
+struct Layout_Of<Wide<P>> : Layout_Of<P> {
+    using tag_type = std::int64_t;
+};
+
+template <typename P>
+struct Layout_Of<Relocatable<P>> : Layout_Of<P> {
+    static constexpr bool relocatable = true;
+};
+
+// -----------
+// heap checks
+// -----------
+
+/**
+ * how My_Resource frees
+ * heap   each block on deallocate
+ * arena  every block at once, on release() or destruction
+ */
+enum class Resource_Mode {heap, arena};
+
+/**
+ * how much of the heap My_Heap checks after each operation
+ * off      nothing
+ * sampled  every block, every period-th operation
+ * touched  the blocks the operation changed and their neighbors
+ * full     every block, every operation
+ */
+enum class Check {off, sampled, touched, full};
+
+/**
+ * the first corruption check_heap() found, if any
+ */
+struct Heap_Report {
+    const char* error  = nullptr; // what is wrong, nullptr if nothing
+    long        index  = -1;      // index of the corrupt block, -1 if none or unknown
+    int         bin    = -1;      // size class whose list is corrupt, -1 if none
+    long        blocks = 0;       // blocks walked, up to the corrupt one
+    long        free   = 0;       // free bytes in those blocks
+
+    explicit operator bool () const {
+        return error == nullptr;
+    }
+};
+
+/**
+ * thrown by an operation after which the check level found a corruption
+ */
+struct Heap_Error : std::logic_error {
+    Heap_Report report;
+
+    explicit Heap_Error (const Heap_Report& r) :
+            std::logic_error (r.error),
+            report           (r)
+        {}
+};
+
+// --------
+// Deferral
+// --------
+
+/**
+ * how My_Heap defers coalescing
+ * a freed block of up to `largest` bytes stays marked busy on a quick list
+ * of blocks of its size, which the next request of that size pops; the held
+ * blocks are all coalesced at once when more than `hold` are held, when a
+ * request can't be placed otherwise, or when no block is allocated
+ * largest 0, the default, coalesces each block as it is freed
+ * largest is at most 255, the quick lists are those of the exact size classes
+ */
+struct Deferral {
+    std::size_t largest = 0;
+    std::size_t hold    = 64;
+};
+
+// ----------
+// Heap_Stats
+// ----------
+
+/**
+ * what My_Heap::stats() reports, sizes in payload bytes, sentinels excluded
+ * the histogram counts free blocks by size class: class b < 32 holds the
+ * blocks of 8b bytes, and class b >= 32 those from 2^(b-24) up to 2^(b-23)
+ */
+struct Heap_Stats {
+    // now
+    std::size_t                   live_bytes   = 0; // in busy blocks
+    std::size_t                   free_bytes   = 0; // in free blocks
+    std::size_t                   largest_free = 0;
+    std::size_t                   busy_blocks  = 0;
+    std::size_t                   free_blocks  = 0;
+    std::array<std::uint32_t, 64> histogram    {};
+    std::size_t                   held_blocks  = 0; // freed, but not yet coalesced, see Deferral and Hardened
+    std::size_t                   held_bytes   = 0;
+    double                        external     = 0; // 1 - largest_free / free_bytes, 0 if nothing is free
+    double                        internal     = 0; // (padding + unsplit) / allocated, 0 if nothing was
+
+    // since construction
+    std::uint64_t allocations    = 0;
+    std::uint64_t deallocations  = 0;
+    std::uint64_t reallocations  = 0;
+    std::uint64_t splits         = 0;
+    std::uint64_t coalesces      = 0;
+    std::uint64_t consolidations = 0; // passes coalescing the held blocks
+    std::uint64_t allocated      = 0; // bytes of the blocks allocated
+    std::uint64_t padding        = 0; // of those, bytes rounding requests up to a block, canaries included
+    std::uint64_t unsplit        = 0; // of those, bytes of remainders too small to split off
+};
+
+// ----------
+// Heap_Image
+// ----------
+
+/**
+ * the header of a heap saved to a file, or of a file a heap is mapped from
+ * the heap follows it at the first multiple of its Align, byte for byte as
+ * it is in memory, which it can be since it holds offsets and no pointers
+ * a heap loads only into a heap of the same type, from the same compiler
+ */
+struct Heap_Image {
+    char          magic[8] = {'A', 'L', 'L', 'O', 'C', 'H', 'E', 'P'};
+    std::uint32_t version  = 1;
+    std::uint32_t clean    = 0; // 1 iff checksum is of the heap as it is, 0 while it is mapped
+    std::uint64_t layout   = 0; // hash of the type of the heap
+    std::uint64_t size     = 0; // bytes of the heap
+    std::uint64_t checksum = 0; // of the bytes of the heap
+};
+
+static_assert(sizeof(Heap_Image) == 40, "a Heap_Image must have no padding");
+
+// ----------
+// offset_ptr
+// ----------
+
+/**
+ * a pointer to a T that keeps the distance from itself to its object,
+ * instead of the object's address, so that it stays valid wherever a
+ * mapping holding both it and its object is mapped, in any process
+ * a copy is the same distance from the object as its own address is, and
+ * a null offset_ptr keeps 1, since no object can start inside it
+ * it meets the requirements on an allocator's pointer
+ */
+template <typename T>
+class offset_ptr {
+    template <typename>
+    friend class offset_ptr;
 
-template <typename T, std::size_t N>
-class My_Allocator {
     // -----------
     // operator ==
     // -----------
 
-    friend bool operator == (const My_Allocator&, const My_Allocator&) { // this is correct
-        return false;
+    friend bool operator == (const offset_ptr& lhs, const offset_ptr& rhs) {
+        return lhs.get() == rhs.get();
+    }
+
+    // ------------
+    // operator <=>
+    // ------------
+
+    friend std::strong_ordering operator <=> (const offset_ptr& lhs, const offset_ptr& rhs) {
+        return std::compare_three_way()(lhs.get(), rhs.get());
+    }
+
+    // ----------
+    // operator +
+    // ----------
+
+    friend offset_ptr operator + (offset_ptr p, std::ptrdiff_t n) {
+        return p += n;
+    }
+
+    friend offset_ptr operator + (std::ptrdiff_t n, offset_ptr p) {
+        return p += n;
+    }
+
+    // ----------
+    // operator -
+    // ----------
+
+    friend offset_ptr operator - (offset_ptr p, std::ptrdiff_t n) {
+        return p -= n;
+    }
+
+    friend std::ptrdiff_t operator - (const offset_ptr& lhs, const offset_ptr& rhs) {
+        return lhs.get() - rhs.get();
+    }
+
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using element_type      = T;
+    using value_type        = std::remove_cv_t<T>;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = offset_ptr;
+    using reference         = std::add_lvalue_reference_t<T>;
+    using iterator_category = std::random_access_iterator_tag;
+
+    template <typename U>
+    using rebind = offset_ptr<U>;
+
+private:
+    // ----
+    // data
+    // ----
+
+    std::ptrdiff_t _d; // from this to the object, 1 if null
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     */
+    void point (const volatile T* p) {
+        _d = (p == nullptr) ? 1 : reinterpret_cast<std::intptr_t>(p) - reinterpret_cast<std::intptr_t>(this);
     }
 
+public:
     // -----------
-    // operator !=
+    // constructor
     // -----------
 
-    friend bool operator != (const My_Allocator& lhs, const My_Allocator& rhs) { // this is correct
-        return !(lhs == rhs);
+    offset_ptr () noexcept :
+            _d (1)
+        {}
+
+    offset_ptr (std::nullptr_t) noexcept :
+            _d (1)
+        {}
+
+    offset_ptr (T* p) noexcept {
+        point(p);
+    }
+
+    offset_ptr (const offset_ptr& that) noexcept {
+        point(that.get());
+    }
+
+    template <typename U>
+        requires std::is_convertible_v<U*, T*>
+    offset_ptr (const offset_ptr<U>& that) noexcept {
+        point(that.get());
+    }
+
+    /**
+     * the static_cast of a pointer to a U, from an offset_ptr<void> in particular
+     */
+    template <typename U>
+        requires (!std::is_convertible_v<U*, T*> && requires (U* u) {static_cast<T*>(u);})
+    explicit offset_ptr (const offset_ptr<U>& that) noexcept {
+        point(static_cast<T*>(that.get()));
+    }
+
+    offset_ptr& operator = (const offset_ptr& that) noexcept {
+        point(that.get());
+        return *this;
+    }
+
+    ~offset_ptr () = default;
+
+    // ---
+    // get
+    // ---
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     */
+    T* get () const noexcept {
+        return (_d == 1) ? nullptr : reinterpret_cast<T*>(reinterpret_cast<std::intptr_t>(this) + _d);
+    }
+
+    explicit operator bool () const noexcept {
+        return _d != 1;
     }
 
+    // ----------
+    // pointer_to
+    // ----------
+
+    template <typename U = T>
+        requires (!std::is_void_v<U>)
+    static offset_ptr pointer_to (U& r) noexcept {
+        return offset_ptr(std::addressof(r));
+    }
+
+    // -----------
+    // dereference
+    // -----------
+
+    template <typename U = T>
+        requires (!std::is_void_v<U>)
+    U& operator * () const {
+        return *get();
+    }
+
+    T* operator -> () const {
+        return get();
+    }
+
+    template <typename U = T>
+        requires (!std::is_void_v<U>)
+    U& operator [] (std::ptrdiff_t n) const {
+        return get()[n];
+    }
+
+    // ----------
+    // arithmetic
+    // ----------
+
+    offset_ptr& operator += (std::ptrdiff_t n) {
+        _d += n * static_cast<std::ptrdiff_t>(sizeof(T));
+        return *this;
+    }
+
+    offset_ptr& operator -= (std::ptrdiff_t n) {
+        _d -= n * static_cast<std::ptrdiff_t>(sizeof(T));
+        return *this;
+    }
+
+    offset_ptr& operator ++ () {
+        return *this += 1;
+    }
+
+    offset_ptr operator ++ (int) {
+        offset_ptr x = *this;
+        ++*this;
+        return x;
+    }
+
+    offset_ptr& operator -- () {
+        return *this -= 1;
+    }
+
+    offset_ptr operator -- (int) {
+        offset_ptr x = *this;
+        --*this;
+        return x;
+    }
+};
+
+// -------
+// My_Heap
+// -------
+
+template <typename T, std::size_t N, typename Policy, std::size_t Align>
+class My_Allocator;
+
+template <typename T, std::size_t N, typename Policy, std::size_t Align>
+class Shm_Allocator;
+
+/**
+ * the boundary-tag heap of N bytes behind My_Allocator, in which a busy
+ * block may hold objects of any type of alignment up to Align
+ * it is not copyable: allocators share it instead
+ */
+template <std::size_t N, typename Policy = First_Fit, std::size_t Align = 8>
+class My_Heap {
+    static_assert(std::has_single_bit(Align) && (Align >= 8), "Align must be a power of two of at least 8");
+
+    template <typename, std::size_t, typename, std::size_t>
+    friend class My_Allocator;
+
+    template <typename, std::size_t, typename, std::size_t>
+    friend class Shm_Allocator;
+
 public:
     // --------
     // typedefs
     // --------
 
-    using value_type      = T;
-
     using size_type       = std::size_t;
     using difference_type = std::ptrdiff_t;
+    using tag_type        = typename Layout_Of<Policy>::tag_type; // a sentinel, negative iff its block is busy, or an index
 
-    using pointer         =       value_type*;
-    using const_pointer   = const value_type*;
-
-    using reference       =       value_type&;
-    using const_reference = const value_type&;
+    static_assert(N / Align * Align <= static_cast<std::size_t>(std::numeric_limits<tag_type>::max()),
+                  "a heap of 2 GiB or more needs Wide sentinels");
 
 public:
     // ---------------
@@ -80,7 +554,7 @@ public:
         // data
         // ----
 
-        My_Allocator& _r;
+        My_Heap&      _r;
         std::size_t   _i;
 
     public:
@@ -88,7 +562,7 @@ public:
         // constructor
         // -----------
 
-        iterator (My_Allocator& r, size_type i) :
+        iterator (My_Heap& r, size_type i) :
             _r (r),
             _i (i)
         {}
@@ -97,7 +571,7 @@ public:
         // operator *
         // ----------
 
-        int& operator * () const { // fix!
+        tag_type& operator * () const { // fix!
             return _r[_i];
         }
 
@@ -106,8 +580,7 @@ public:
         // -----------
 
         iterator& operator ++ () { // fix!
-            int block_size = std::abs(_r[_i]);
-            _i += block_size + 8;
+            _i = _r.next_block(_i);
             return *this;
         }
 
@@ -126,9 +599,7 @@ public:
         // -----------
 
         iterator& operator -- () { // fix!
-            int prevEndIndex = _i - 4;
-            int prevSize = std::abs(_r[prevEndIndex]);
-            _i -= prevSize + 8;
+            _i = _r.prev_block(_i);
             return *this;
         }
 
@@ -170,7 +641,7 @@ public:
         // data
         // ----
 
-        const My_Allocator& _r;
+        const My_Heap&      _r;
         std::size_t         _i;
 
     public:
@@ -178,7 +649,7 @@ public:
         // constructor
         // -----------
 
-        const_iterator (const My_Allocator& r, size_type i) :
+        const_iterator (const My_Heap& r, size_type i) :
             _r (r),
             _i (i)
         {}
@@ -188,7 +659,7 @@ public:
         // ----------
 
         // beginning sentinel of the block
-        const int& operator * () const { // fix!
+        const tag_type& operator * () const { // fix!
             return _r[_i];
         }
 
@@ -197,8 +668,7 @@ public:
         // -----------
 
         const_iterator& operator ++ () { // fix!
-            int block_size = std::abs(_r[_i]);
-            _i += block_size + 8;
+            _i = _r.next_block(_i);
             return *this;
         }
 
@@ -217,9 +687,7 @@ public:
         // -----------
 
         const_iterator& operator -- () { // fix!
-            int prevEndIndex = _i - 4;
-            int prevSize = std::abs(_r[prevEndIndex]);
-            _i -= prevSize + 8;
+            _i = _r.prev_block(_i);
             return *this;
         }
 
@@ -239,246 +707,4010 @@ private:
     // data
     // ----
 
-    char a[N]; // array of bytes
+    // The heap is the first `bytes` of N, a multiple of Align. Every block
+    // spans a multiple of Align, sentinels included, and the array is offset
+    // by `pad` so that each payload, a word after its block, is aligned. A
+    // word is a tag_type, 4 bytes, or 8 with Wide. The size of a block is its
+    // span less `over`, the bytes of its sentinels: a header and a footer,
+    // or on the compact layout only a header, whose low bit is set iff the
+    // block before is free. There a free block's footer is in the last word
+    // of its size. On a hardened heap a busy block's canary is in that same
+    // word. Links and indices are words too.
 
-    // -----
-    // valid
-    // -----
+    using placement = typename Layout_Of<Policy>::placement;
 
-    /**
-     * O(1) in space
-     * O(n) in time
-     * Check if the allocator's sentinels are consistent
-     */
-    bool valid () const {
-        int i = 0;
-        while (i < static_cast<int>(N)) {
-            int block_size = (*this)[i];
-            int block_end = i + 4 + std::abs(block_size);
-            if (block_end + 4 > static_cast<int>(N)) {
-                return false;
-            }
-            int end_sentinel = (*this)[block_end];
-            if (block_size != end_sentinel) {
-                return false;
-            }
-            i = block_end + 4;
-        }
-        return true;
-    }
+    static constexpr bool        compact     = Layout_Of<Policy>::compact;
+    static constexpr bool        hardened    = Layout_Of<Policy>::hardened;
+    static constexpr std::size_t quarantined = Layout_Of<Policy>::quarantine; // most blocks in the quarantine
+    static constexpr std::size_t bytes       = N / Align * Align;
+    static constexpr tag_type    word        = sizeof(tag_type);
+    static constexpr tag_type    pad         = Align - word;
+    static constexpr tag_type    over        = compact ? word : 2 * word;
+    static constexpr tag_type    least       = 4 * word - over; // the smallest size, room for the links and footer once free
+    static constexpr tag_type    guard       = hardened ? word : 0; // bytes of a payload taken by its canary
+    static constexpr tag_type    poisoned    = 64; // most bytes of a freed payload poisoned
+    static constexpr unsigned char poison    = 0xDB;
 
-public:
-    // -----------
-    // constructor
-    // -----------
+    alignas(Align) char a[pad + N]; // array of bytes
+    tag_type      _bin[64];   // index of the first free block of each size class, -1 if none
+    tag_type      _quick[32]; // index of the first held block of each exact size class, -1 if none
+    Deferral      _deferral;  // which freed blocks to hold, and how many
+    std::uint64_t _map;       // bit b is set iff _bin[b] is not empty
+    tag_type      _rover;     // index after the previous allocation, for Next_Fit
+    Check         _check;     // how much of the heap to check after each operation
+    unsigned      _period;    // operations between two checks, for Check::sampled
+    unsigned      _tick;      // operations since construction, for Check::sampled
+    Heap_Stats    _stats;     // the counters of stats(), kept up to date by every operation
+    std::uint32_t _secret;    // of the canaries, so that they can't be guessed
+    std::array<tag_type, std::max<std::size_t>(quarantined, 1)> _quarantine; // the quarantined blocks, oldest at _oldest
+    unsigned      _oldest;    // where the oldest quarantined block is in _quarantine
+    unsigned      _held;      // blocks in the quarantine
+    tag_type      _patrol;    // index of the block patrol() checks next
+    tag_type      _root;      // offset of the root object, -1 if none
+
+    // ----
+    // bins
+    // ----
+
+    // A free block keeps two links at the front of its payload: the index of
+    // the previous and of the next free block of its size class, -1 at either
+    // end. Blocks under 256 bytes are binned exactly, by 8-byte granule, and
+    // larger ones by power of two. For First_Fit and Next_Fit each bin is kept
+    // in address order, so that the lowest head over the bins that fit is the
+    // same first fit as walking every block. The other policies only look at
+    // sizes, so they push freed blocks on the front of their bin.
+
+    static constexpr bool ordered = std::is_same_v<placement, First_Fit> || std::is_same_v<placement, Next_Fit>;
 
     /**
      * O(1) in space
      * O(1) in time
-     * throw a std::bad_alloc exception, if N is less than sizeof(T) + (2 * sizeof(int))
+     * the size class of a block of s bytes
      */
-    My_Allocator () {
-        if (N < (8 + (2 * sizeof(int))))
-            throw std::bad_alloc();
-        (*this)[0]   = N-8;
-        (*this)[N-4] = N-8;
-        assert(valid());
+    static int bin (tag_type s) {
+        if (s < 256)
+            return s / 8;
+        return std::min(32 + static_cast<int>(std::bit_width(static_cast<std::make_unsigned_t<tag_type>>(s))) - 9, 63);
     }
 
-    My_Allocator             (const My_Allocator&) = default;
-    ~My_Allocator            ()                    = default;
-    My_Allocator& operator = (const My_Allocator&) = default;
-
-    // --------
-    // allocate
-    // --------
+    tag_type& prev_free (tag_type i) {
+        return (*this)[i + word];
+    }
 
-    /**
-     * O(1) in space
-     * O(n) in time
-     * after allocation there must be enough space left for a valid block
-     * the smallest allowable block is sizeof(T) + (2 * sizeof(int))
-     * choose the first block that fits
-     * throw a std::bad_alloc exception, if there isn't an acceptable free block
-     */
-    pointer allocate (size_type s) {
-        int size_in_bytes = s * 8; // Object size is 8 bytes
-
-        for (iterator it = begin(); it != end(); ++it) {
-            int& block_size = *it;
-            if (block_size > 0 && block_size >= size_in_bytes) {
-                int original_size = block_size;
-                int remaining = original_size - size_in_bytes - 8; // Remaining data size after allocating and adding end sentinel
-
-                if (remaining >= static_cast<int>(8)) {
-                    // Split the block
-                    block_size = -size_in_bytes;
-                    (*this)[it._i + 4 + size_in_bytes] = -size_in_bytes; // End sentinel for allocated block
-                    // Create new free block
-                    int new_block_index = it._i + 8 + size_in_bytes;
-                    (*this)[new_block_index] = remaining;
-                    (*this)[new_block_index + 4 + remaining] = remaining;
-                } else {
-                    // Do not split, allocate entire block
-                    block_size = -original_size;
-                    (*this)[it._i + 4 + original_size] = -original_size;
-                }
-                assert(valid());
-                return reinterpret_cast<pointer>(&a[it._i +4]);
-            }
-        }
-        throw std::bad_alloc();
+    tag_type prev_free (tag_type i) const {
+        return (*this)[i + word];
     }
 
+    tag_type& next_free (tag_type i) {
+        return (*this)[i + 2 * word];
+    }
 
-    // ---------
-    // construct
-    // ---------
+    tag_type next_free (tag_type i) const {
+        return (*this)[i + 2 * word];
+    }
 
     /**
      * O(1) in space
      * O(1) in time
+     * write both sentinels of the block at i
+     * on the compact layout, a busy block keeps the bit of its header, and
+     * the bit of the next block's header says whether this one is free
      */
-    void construct (pointer p, const_reference v) { // this is correct and exempt
-        new (p) T(v);                               // from the prohibition of new
-        assert(valid());
+    void tag (tag_type i, tag_type v) {
+        if constexpr (compact) {
+            const tag_type j = i + std::abs(v) + word;
+            if (v < 0)
+                v -= ((*this)[i] < 0) ? (-(*this)[i] & 1) : 0;
+            else
+                (*this)[i + v] = v;
+            (*this)[i] = v;
+            if ((j < static_cast<tag_type>(bytes)) && ((*this)[j] < 0))
+                (*this)[j] = -((-(*this)[j] & ~1) | (v > 0));
+        }
+        else {
+            (*this)[i]                      = v;
+            (*this)[i + word + std::abs(v)] = v;
+        }
     }
-    // ----------
-    // deallocate
-    // ----------
 
     /**
      * O(1) in space
      * O(1) in time
-     * after deallocation adjacent free blocks must be coalesced
-     * throw an invalid_argument exception, if p is invalid
+     * link the free block at i into bin b between prev and next
      */
-    // ----------
-// deallocate
-// ----------
+    void link (tag_type i, int b, tag_type prev, tag_type next) {
+        prev_free(i) = prev;
+        next_free(i) = next;
+        if (prev == -1) {
+            _bin[b] = i;
+            _map |= std::uint64_t(1) << b;
+        }
+        else
+            next_free(prev) = i;
+        if (next != -1)
+            prev_free(next) = i;
+    }
 
     /**
      * O(1) in space
      * O(1) in time
-     * after deallocation adjacent free blocks must be coalesced
-     * throw an invalid_argument exception, if p is invalid
+     * unlink the free block at i from bin b
      */
-// deallocate
-// ----------
+    void unlink (tag_type i, int b) {
+        const tag_type prev = prev_free(i);
+        const tag_type next = next_free(i);
+        if (prev == -1) {
+            _bin[b] = next;
+            if (next == -1)
+                _map &= ~(std::uint64_t(1) << b);
+        }
+        else
+            next_free(prev) = next;
+        if (next != -1)
+            prev_free(next) = prev;
+        _stats.free_bytes -= (*this)[i];
+        --_stats.free_blocks;
+        --_stats.histogram[b];
+    }
 
     /**
      * O(1) in space
-     * O(1) in time
-     * After deallocation adjacent free blocks must be coalesced.
-     * Throw an invalid_argument exception, if p is invalid.
+     * O(b) in time, b the number of free blocks in the bin of s
+     * the free block at i, in the bin of s, becomes the free block at j of v
+     * bytes, where no free block lies between i and j
      */
-    void deallocate(pointer p, size_type) {
-        int index = reinterpret_cast<char*>(p) - a - 4;
-        if (index < 0 || index >= static_cast<int>(N)) {
-            throw std::invalid_argument("Invalid pointer");
+    void rebin (tag_type i, tag_type s, tag_type j, tag_type v) {
+        const int b = bin(s);
+        if (b == bin(v)) {
+            const tag_type prev = prev_free(i);
+            const tag_type next = next_free(i);
+            tag(j, v);
+            link(j, b, prev, next);
+            _stats.free_bytes += v - s;
         }
-
-        int& block_size = (*this)[index];
-        if (block_size >= 0) {
-            throw std::invalid_argument("Block is already free");
-        }
-
-        // Mark block as free
-        int size = -block_size;
-        block_size = size;
-        (*this)[index + 4 + size] = size;
-
-        // Coalesce with the next block if it is free
-        int next_index = index + size + 8;
-        if (next_index < static_cast<int>(N)) {
-            int& next_block_size = (*this)[next_index];
-            if (next_block_size > 0) {
-                // Update size to include the next free block and the header/footer
-                size += next_block_size + 8;
-                (*this)[index] = size;  // Update start sentinel
-                (*this)[index + 4 + size] = size;  // Update end sentinel
-                block_size = size; // Update block_size after coalescing
-            }
+        else {
+            unlink(i, b);
+            tag(j, v);
+            insert(j);
         }
+    }
 
-        // Coalesce with the previous block if it is free
-        if (index > 0) {
-            int prev_end_index = index - 4;
-            int prev_size = (*this)[prev_end_index];
-            if (prev_size > 0) {
-                int prev_index = index - prev_size - 8;
-                // Update size to include the previous free block and the header/footer
-                size += prev_size + 8;
-                (*this)[prev_index] = size;  // Update start sentinel
-                (*this)[prev_index + 4 + size] = size;  // Update end sentinel
-                index = prev_index;      // Update index to new start
-                block_size = size;       // Update block_size to new size
+    /**
+     * O(1) in space
+     * O(b) in time, b the number of free blocks in the bin, if ordered
+     * O(1) in time otherwise
+     * link the free block at i into its bin
+     */
+    void insert (tag_type i) {
+        const int b    = bin((*this)[i]);
+        tag_type  prev = -1;
+        tag_type  next = _bin[b];
+        if constexpr (ordered) {
+            while ((next != -1) && (next < i)) {
+                prev = next;
+                next = next_free(next);
             }
         }
+        link(i, b, prev, next);
+        _stats.free_bytes += (*this)[i];
+        ++_stats.free_blocks;
+        ++_stats.histogram[b];
+    }
 
-        assert(valid());
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the bins above the bin of s, all of whose blocks fit s
+     */
+    std::uint64_t above (tag_type s) const {
+        const int b = bin(s);
+        return (b == 63) ? 0 : (_map >> (b + 1)) << (b + 1);
     }
 
+    /**
+     * O(1) in space
+     * O(b) in time, b the number of free blocks in the bin of s
+     * the lowest free block of at least s bytes, -1 if none
+     * the bin of s is searched, only the head of every larger bin can be first
+     */
+    tag_type first_fit (tag_type s) const {
+        tag_type i = _bin[bin(s)];
+        while ((i != -1) && ((*this)[i] < s))
+            i = next_free(i);
+        std::uint64_t m = above(s);
+        while (m != 0) {
+            const tag_type j = _bin[std::countr_zero(m)];
+            if ((i == -1) || (j < i))
+                i = j;
+            m &= m - 1;
+        }
+        return i;
+    }
 
+    /**
+     * O(1) in space
+     * O(f) in time, f the number of free blocks in the bins that fit s
+     * the lowest free block of at least s bytes at or after _rover,
+     * else the lowest one before it, -1 if none
+     */
+    tag_type next_fit (tag_type s) const {
+        tag_type i = _bin[bin(s)];
+        while ((i != -1) && (((*this)[i] < s) || (i < _rover)))
+            i = next_free(i);
+        std::uint64_t m = above(s);
+        while (m != 0) {
+            tag_type j = _bin[std::countr_zero(m)];
+            while ((j != -1) && (j < _rover))
+                j = next_free(j);
+            if ((j != -1) && ((i == -1) || (j < i)))
+                i = j;
+            m &= m - 1;
+        }
+        return (i == -1) ? first_fit(s) : i;
+    }
 
-    // -------
-    // destroy
-    // -------
+    /**
+     * O(1) in space
+     * O(f) in time, f the number of free blocks in the bins that fit s
+     * the smallest of the first k free blocks of at least s bytes, -1 if none
+     * bins are taken smallest first, so every block of a later bin is larger
+     */
+    tag_type good_fit (tag_type s, int k) const {
+        tag_type i = -1;
+        std::uint64_t m = (_map >> bin(s)) << bin(s);
+        while ((m != 0) && (k != 0)) {
+            for (tag_type j = _bin[std::countr_zero(m)]; (j != -1) && (k != 0); j = next_free(j)) {
+                const tag_type v = (*this)[j];
+                if (v >= s) {
+                    if ((i == -1) || (v < (*this)[i]))
+                        i = j;
+                    if (v == s)
+                        return i;
+                    --k;
+                }
+            }
+            if (i != -1)
+                return i;
+            m &= m - 1;
+        }
+        return i;
+    }
+
+    /**
+     * O(1) in space
+     * the free block the policy places s bytes in, -1 if none
+     */
+    tag_type find (tag_type s) const {
+        if constexpr (std::is_same_v<placement, First_Fit>)
+            return first_fit(s);
+        else if constexpr (std::is_same_v<placement, Next_Fit>)
+            return next_fit(s);
+        else
+            return good_fit(s, placement::candidates);
+    }
+
+    // ------
+    // blocks
+    // ------
 
     /**
      * O(1) in space
      * O(1) in time
+     * the size of the block at i
      */
-    void destroy (pointer p) { // this is correct
-        p->~T();
-        assert(valid());
+    tag_type size_of (tag_type i) const {
+        return std::abs((*this)[i]) & ~1;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the index of the block after the one at i
+     */
+    tag_type next_block (tag_type i) const {
+        return i + size_of(i) + over;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * true iff there is a block before the one at i and it is free
+     */
+    bool prev_is_free (tag_type i) const {
+        if constexpr (compact)
+            return ((*this)[i] < 0) && ((-(*this)[i] & 1) != 0);
+        else
+            return (i > 0) && ((*this)[i - word] > 0);
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time, from its footer, if the block before the one at i is free
+     * or the layout isn't compact
+     * O(n) in time otherwise, or from the end, walking the blocks from the first
+     * the index of the block before the one at i
+     */
+    tag_type prev_block (tag_type i) const {
+        if (!compact || ((i < static_cast<tag_type>(bytes)) && prev_is_free(i)))
+            return i - std::abs((*this)[i - word]) - over;
+        tag_type j = 0;
+        for (tag_type k = next_block(j); k < i; k = next_block(k))
+            j = k;
+        return j;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the index of the busy block whose payload is at p
+     * throw an invalid_argument exception, if p is invalid
+     */
+    tag_type busy_block (const void* p) const {
+        tag_type index = reinterpret_cast<const char*>(p) - a - pad - word;
+        if (index < 0 || index >= static_cast<tag_type>(bytes)) {
+            throw std::invalid_argument("Invalid pointer");
+        }
+
+        if ((*this)[index] >= 0) {
+            throw std::invalid_argument("Block is already free");
+        }
+        return index;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the canary of a busy block at i, on a hardened heap, the complement of
+     * which marks a block freed but still in the quarantine
+     */
+    tag_type canary (tag_type i) const {
+        const std::uint64_t k = (std::uint64_t(_secret) << 32) | _secret;
+        return static_cast<tag_type>(k ^ (static_cast<std::uint64_t>(i) * 0x9E3779B97F4A7C15ull));
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time, unless the last word of the block at i holds the mark
+     * of a held block
+     * O(h) in time otherwise, h the number of held blocks of its size
+     * true iff the busy block at i is held on a quick list
+     * a held block's last word is marked with its complemented canary, and
+     * only when a live block's bytes happen to match the mark is the quick
+     * list walked
+     */
+    bool held (tag_type i) const {
+        const tag_type s = size_of(i);
+        if ((s > 255) || ((*this)[i + s] != ~canary(i)))
+            return false;
+        for (tag_type j = _quick[quick(s)]; j != -1; j = (*this)[j + word])
+            if (j == i)
+                return true;
+        return false;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time, but for held(), see there
+     * the index of the busy block whose payload is at p, as busy_block, and
+     * it must not be held, nor on a hardened heap in the quarantine, and
+     * there its canary must be intact
+     * throw an invalid_argument exception, if p is invalid or its block was freed
+     * throw a Heap_Error exception, if its canary was overwritten
+     */
+    tag_type live_block (const void* p) const {
+        const tag_type index = busy_block(p);
+        if constexpr (!hardened) {
+            if (held(index))
+                throw std::invalid_argument("Block is already free");
+        }
+        else {
+            const tag_type c = (*this)[index + size_of(index)];
+            if (c == ~canary(index))
+                throw std::invalid_argument("Block is already free");
+            if (c != canary(index)) {
+                Heap_Report r;
+                r.error = "canary overwritten";
+                r.index = index;
+                throw Heap_Error(r);
+            }
+        }
+        return index;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the blocks that started after i and before j are now part of the one
+     * at i, so patrol() goes on from i if it was to go on from one of them
+     */
+    void merged (tag_type i, tag_type j) {
+        if constexpr (hardened)
+            if ((i < _patrol) && (_patrol < j))
+                _patrol = i;
+    }
+
+    /**
+     * O(1) in space
+     * the index of the block the Policy picks for a payload of size_in_bytes,
+     * now busy, -1 if there isn't an acceptable free block
+     */
+    tag_type place (tag_type size_in_bytes) {
+        if (const tag_type i = unhold(size_in_bytes); i != -1) {
+            ++_stats.busy_blocks;
+            ++_stats.allocations;
+            _stats.allocated += size_in_bytes;
+            (*this)[i + size_in_bytes] = canary(i); // no longer marked held
+            return i;
+        }
+        tag_type i = find(size_in_bytes);
+        if ((i == -1) && (_stats.held_blocks != 0)) {
+            consolidate();
+            i = find(size_in_bytes);
+        }
+        if (i == -1)
+            return -1;
+        _rover = i + over + size_in_bytes;
+
+        tag_type original_size = (*this)[i];
+        tag_type remaining = original_size - size_in_bytes - over; // Remaining data size after allocating and adding end sentinel
+
+        if (remaining >= least) {
+            // Split the block, the remainder moves to its own bin
+            rebin(i, original_size, i + over + size_in_bytes, remaining);
+            tag(i, -size_in_bytes);
+            ++_stats.splits;
+        } else {
+            // Do not split, allocate entire block
+            unlink(i, bin(original_size));
+            tag(i, -original_size);
+            _stats.unsplit += original_size - size_in_bytes;
+        }
+        ++_stats.busy_blocks;
+        ++_stats.allocations;
+        _stats.allocated += size_of(i);
+        (*this)[i + size_of(i)] = canary(i); // nor marked held from an earlier life
+        return i;
+    }
+
+    /**
+     * O(1) in space
+     * O(b) in time, b the number of free blocks in the bin of the coalesced block, if ordered
+     * O(1) in time otherwise
+     * free the busy bytes from index up to the end of a payload of size,
+     * which may span several busy blocks, coalescing them with free neighbors
+     * return the index of the coalesced block
+     */
+    tag_type release (tag_type index, tag_type size) {
+        // Check both neighbors before touching any sentinel
+        tag_type next_index = index + size + over;
+        bool     next_free  = (next_index < static_cast<tag_type>(bytes)) && ((*this)[next_index] > 0);
+        bool prev_free  = prev_is_free(index);
+
+        _stats.coalesces += prev_free + next_free;
+        if (prev_free) {
+            // The previous block grows in place, the next one leaves its bin
+            tag_type prev_size  = (*this)[index - word];
+            tag_type prev_index = index - prev_size - over;
+            size += prev_size + over;
+            if (next_free) {
+                tag_type next_size = (*this)[next_index];
+                unlink(next_index, bin(next_size));
+                size += next_size + over;
+            }
+            rebin(prev_index, prev_size, prev_index, size);
+            merged(prev_index, next_block(prev_index));
+            return prev_index;
+        } else if (next_free) {
+            // This block takes the place of the next one
+            tag_type next_size = (*this)[next_index];
+            rebin(next_index, next_size, index, size + next_size + over);
+        } else {
+            tag(index, size);
+            insert(index);
+        }
+        merged(index, next_block(index));
+        return index;
     }
 
     // -----------
-    // operator []
+    // quick lists
     // -----------
 
+    // A held block keeps its busy sentinels, so that its neighbors don't
+    // coalesce with it, the index of the next held block of its size in
+    // the first word of its payload, and its complemented canary in the
+    // last, which marks it held. A block just placed has its canary there,
+    // even on a heap that isn't hardened, so that it isn't marked.
+
     /**
      * O(1) in space
      * O(1) in time
+     * the quick list of a block of s < 256 bytes, the same as its size class
      */
-    int& operator [] (int i) { // this is correct
-        return *reinterpret_cast<int*>(&a[i]);
+    static int quick (tag_type s) {
+        return (s / 8) & 31;
     }
 
     /**
      * O(1) in space
      * O(1) in time
+     * hold the busy block at i on the quick list of its size, and mark it
+     * with its complemented canary, as a quarantined block is
      */
-    const int& operator [] (int i) const { // this is correct
-        return *reinterpret_cast<const int*>(&a[i]);
+    void hold (tag_type i) {
+        const tag_type s = size_of(i);
+        const int b = quick(s);
+        (*this)[i + word] = _quick[b];
+        _quick[b]      = i;
+        (*this)[i + s] = ~canary(i);
+        ++_stats.held_blocks;
+        _stats.held_bytes += s;
     }
 
-    // -----
-    // begin
-    // -----
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the index of a held block of s bytes, now off its quick list, -1 if none
+     */
+    tag_type unhold (tag_type s) {
+        if (s > static_cast<tag_type>(_deferral.largest))
+            return -1;
+        const int b = quick(s);
+        const tag_type i = _quick[b];
+        if (i != -1) {
+            _quick[b] = (*this)[i + word];
+            --_stats.held_blocks;
+            _stats.held_bytes -= s;
+        }
+        return i;
+    }
 
-    iterator begin () { // this is correct
-        return iterator(*this, 0);
+    // ----------
+    // quarantine
+    // ----------
+
+    // A quarantined block keeps its busy sentinels, as a held one does, its
+    // first bytes are poisoned, and its canary is complemented. It leaves
+    // the quarantine, oldest first, to be freed as any other block.
+
+    /**
+     * O(1) in space
+     * O(p) in time, p the bytes poisoned
+     * true iff the quarantined block at j is as it was when it was freed
+     */
+    bool intact (tag_type j) const {
+        static constexpr auto poisons = [] {
+            std::array<unsigned char, poisoned> b;
+            b.fill(poison);
+            return b;
+        }();
+        const tag_type s = size_of(j);
+        return ((*this)[j + s] == ~canary(j)) &&
+               (std::memcmp(&(*this)[j + word], poisons.data(), std::min(s - word, poisoned)) == 0);
     }
 
-    const_iterator begin () const { // this is correct
-        return const_iterator(*this, 0);
+    /**
+     * O(1) in space
+     * O(p) in time, p the bytes poisoned
+     * the quarantined block at j, which must be intact
+     * throw a Heap_Error exception, if it isn't
+     */
+    void inspect (tag_type j) const {
+        if (!intact(j)) {
+            Heap_Report r;
+            r.error = "block written after it was freed";
+            r.index = j;
+            throw Heap_Error(r);
+        }
     }
 
-    // ---
-    // end
-    // ---
+    /**
+     * O(1) in space
+     * O(p) in time, p the bytes poisoned
+     * poison the busy block at i and put it in the quarantine
+     * return the oldest quarantined block, now out of the quarantine and
+     * still busy, if the quarantine was full, -1 otherwise
+     * throw a Heap_Error exception, if that block isn't intact, before
+     * changing anything
+     */
+    tag_type quarantine (tag_type i) {
+        tag_type j = -1;
+        if (_held == quarantined) {
+            j = _quarantine[_oldest];
+            inspect(j);
+            _oldest = (_oldest + 1) % quarantined;
+            --_held;
+            --_stats.held_blocks;
+            _stats.held_bytes -= size_of(j);
+        }
+        const tag_type s = size_of(i);
+        std::memset(&(*this)[i + word], poison, std::min(s - word, poisoned));
+        (*this)[i + s] = ~canary(i);
+        _quarantine[(_oldest + _held) % quarantined] = i;
+        ++_held;
+        ++_stats.held_blocks;
+        _stats.held_bytes += s;
+        return j;
+    }
 
-    iterator end () { // this is correct
-        return iterator(*this, N);
+    // ------
+    // checks
+    // ------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * true iff k can be the index of a free block: in the heap, with room
+     * for its links, and on a multiple of Align, where every block starts,
+     * so that a corrupt link is reported instead of followed to a misaligned word
+     */
+    static bool boundary (tag_type k) {
+        return (k >= 0) && (k < static_cast<tag_type>(bytes) - 3 * word) && (k % static_cast<tag_type>(Align) == 0);
     }
 
-    const_iterator end () const { // this is correct
-        return const_iterator(*this, N);
+    /**
+     * O(1) in space
+     * O(1) in time
+     * what is wrong with the block at i, nullptr if nothing
+     * its sentinels must match and span a whole number of Align, and if it
+     * is free its links must point back at it and its successor must be busy
+     * on the compact layout, the bit of its successor must say whether it is
+     * free, and the first block's must be clear
+     * on a hardened heap, if it is busy its canary must be intact or complemented
+     */
+    const char* check_block (tag_type i) const {
+        const long v = (*this)[i];
+        const long s = compact ? (std::abs(v) & ~1L) : std::abs(v);
+        if ((s < least) || ((s + over) % static_cast<long>(Align) != 0) || ((v > 0) && (s != v)))
+            return "bad block size";
+        if (i + s + over > static_cast<long>(bytes))
+            return "block overruns the heap";
+        const tag_type end = i + over + static_cast<tag_type>(s);
+        if ((!compact || (v > 0)) && ((*this)[end - word] != v))
+            return "sentinels differ";
+        if constexpr (compact) {
+            if ((i == 0) && prev_is_free(i))
+                return "free bit of the block before out of date";
+            if ((end < static_cast<tag_type>(bytes)) && ((*this)[end] < 0) && (prev_is_free(end) != (v > 0)))
+                return "free bit of the block before out of date";
+        }
+        if constexpr (hardened)
+            if ((v < 0) && ((*this)[end - over] != canary(i)) && ((*this)[end - over] != ~canary(i)))
+                return "canary overwritten";
+        if (v < 0)
+            return nullptr;
+        const tag_type prev = prev_free(i);
+        const tag_type next = next_free(i);
+        if (prev == -1) {
+            if (_bin[bin(static_cast<tag_type>(v))] != i)
+                return "free block is not the head of its bin";
+        }
+        else if (!boundary(prev) || (next_free(prev) != i))
+            return "bad link to the previous free block";
+        if ((next != -1) && (!boundary(next) || (prev_free(next) != i)))
+            return "bad link to the next free block";
+        if ((end < static_cast<tag_type>(bytes)) && ((*this)[end] > 0))
+            return "free blocks not coalesced";
+        return nullptr;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * check the block at i and its neighbors, as check_heap() would
+     * on the compact layout, a busy block before it has no footer to find
+     * it by, and isn't checked
+     */
+    Heap_Report check_near (tag_type i) const {
+        Heap_Report r;
+        tag_type j = i;
+        if ((i > 0) && (!compact || prev_is_free(i))) {
+            const long s = std::abs(static_cast<long>((*this)[i - word]));
+            if ((s < least) || (s > i - over) || ((s + over) % static_cast<long>(Align) != 0)) {
+                r.error = "block overruns the heap";
+                r.index = i;
+                return r;
+            }
+            j = i - static_cast<tag_type>(s) - over;
+        }
+        while (j < static_cast<tag_type>(bytes)) {
+            if ((r.error = check_block(j)) != nullptr) {
+                r.index = j;
+                return r;
+            }
+            ++r.blocks;
+            const tag_type v = (*this)[j];
+            r.free += std::max<tag_type>(v, 0);
+            const tag_type k = j;
+            j = next_block(j);
+            if (k > i)
+                break;
+        }
+        return r;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * after an operation that changed the block at i, check it and its
+     * neighbors, if the check level is Check::touched
+     * throw a Heap_Error exception, if that finds a corruption
+     */
+    void touched (tag_type i) const {
+        if (_check != Check::touched)
+            return;
+        const Heap_Report r = check_near(i);
+        if (!r)
+            throw Heap_Error(r);
+    }
+
+    /**
+     * O(1) in space
+     * O(n) in time, if the check level is Check::full, or every period-th call
+     * for Check::sampled
+     * O(1) in time otherwise
+     * after an operation, check every block if the check level says so
+     * throw a Heap_Error exception, if that finds a corruption
+     */
+    void audit () {
+        if ((_check != Check::full) && ((_check != Check::sampled) || (++_tick % _period != 0)))
+            return;
+        const Heap_Report r = check_heap();
+        if (!r)
+            throw Heap_Error(r);
+    }
+
+    /**
+     * O(1) in space
+     * O(n) in time
+     */
+    bool valid () const {
+        return static_cast<bool>(check_heap());
+    }
+
+    // ------
+    // images
+    // ------
+
+    // A heap is saved as a Heap_Image and the bytes of the heap, at offset
+    // `image` in the file. A mapped heap is at that same offset in its
+    // mapping, so that a saved heap can be mapped and a mapped one loaded.
+    // A mapped heap's header is clean only once it is unmapped; a heap found
+    // mapped, because its process died, has no checksum to check, and its
+    // blocks are checked instead.
+
+    static constexpr std::size_t image = (sizeof(Heap_Image) + Align - 1) / Align * Align;
+
+    /**
+     * O(1) in space
+     * O(n) in time
+     * FNV-1a over the 8-byte words of n bytes at p, n a multiple of 8
+     */
+    static std::uint64_t fingerprint (const void* p, std::size_t n) {
+        std::uint64_t h = 0xCBF29CE484222325ull;
+        for (std::size_t k = 0; k != n; k += 8) {
+            std::uint64_t w;
+            std::memcpy(&w, static_cast<const char*>(p) + k, 8);
+            h = (h ^ w) * 0x100000001B3ull;
+        }
+        return h;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the header of a heap of this type, without its checksum
+     */
+    static Heap_Image header () {
+        Heap_Image h;
+        h.layout = 0xCBF29CE484222325ull;
+        for (const char* c = typeid(My_Heap).name(); *c != '\0'; ++c)
+            h.layout = (h.layout ^ static_cast<unsigned char>(*c)) * 0x100000001B3ull;
+        h.size   = sizeof(My_Heap);
+        return h;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * true iff h is the header of a heap of this type
+     */
+    static bool matches (const Heap_Image& h) {
+        const Heap_Image expected = header();
+        return (std::memcmp(h.magic, expected.magic, sizeof(h.magic)) == 0) && (h.version == expected.version) &&
+               (h.layout == expected.layout) && (h.size == expected.size);
+    }
+
+    /**
+     * O(1) in space
+     * O(n) in time
+     * read or write n bytes at p from or to the file fd at offset k, as
+     * pread or pwrite, which may each move fewer
+     * return false if one fails or the file ends first
+     */
+    template <typename F, typename P>
+    static bool transfer (F f, int fd, P p, std::size_t n, off_t k) {
+        while (n != 0) {
+            const ssize_t m = f(fd, p, n, k);
+            if (m <= 0)
+                return false;
+            p  = p + m;
+            n -= m;
+            k += m;
+        }
+        return true;
+    }
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * throw a std::bad_alloc exception, if N is less than one aligned block of over + least bytes
+     */
+    My_Heap () :
+            _map    (0),
+            _rover  (0),
+#ifdef NDEBUG
+            _check  (Check::off),
+#else
+            _check  (Check::touched),
+#endif
+            _period (64),
+            _tick   (0),
+            _secret (static_cast<std::uint32_t>((std::chrono::steady_clock::now().time_since_epoch().count() * 0x9E3779B97F4A7C15ull) >> 32) ^
+                     static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(this))),
+            _oldest (0),
+            _held   (0),
+            _patrol (0),
+            _root   (-1) {
+        if (bytes < std::max<std::size_t>(Align, over + least))
+            throw std::bad_alloc();
+        std::fill(_bin, _bin + 64, -1);
+        std::fill(_quick, _quick + 32, -1);
+        tag(0, bytes - over);
+        insert(0);
+        assert(valid());
+    }
+
+    My_Heap             (const My_Heap&) = delete;
+    ~My_Heap            ()               = default;
+    My_Heap& operator = (const My_Heap&) = delete;
+
+    // --------
+    // block_of
+    // --------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the payload size of a block holding s objects of type T
+     * at least least bytes, so that the block can hold its links once free,
+     * and Align - over more than a multiple of Align, so that the next payload is aligned
+     * on a hardened heap, with room for the canary after the objects
+     * -1 if that doesn't fit in a tag_type
+     */
+    template <typename T = char>
+    static tag_type block_of (size_type s) {
+        constexpr size_type most = (std::numeric_limits<tag_type>::max() - 2 * Align) / sizeof(T);
+        if (s > most)
+            return -1;
+        const size_type v = (s * sizeof(T) + guard + over + Align - 1) / Align * Align - over;
+        return std::max(static_cast<tag_type>(v), least);
+    }
+
+    // -------
+    // largest
+    // -------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the payload size of the one free block of an empty heap, the most
+     * that block_of of any request can be and still be met
+     */
+    static constexpr tag_type largest () {
+        return static_cast<tag_type>(bytes) - over;
     }
-};
 
+    // --------
+    // allocate
+    // --------
+
+    /**
+     * O(1) in space
+     * O(b) in time, b the number of free blocks in the bin of the request, for First_Fit
+     * O(f) in time, f the number of free blocks in the bins that fit, otherwise
+     * after allocation there must be enough space left for a valid block
+     * the smallest allowable block is block_of(1) + over
+     * choose the block the Policy picks
+     * throw a std::bad_alloc exception, if there isn't an acceptable free block
+     */
+    template <typename T = char>
+    T* allocate (size_type s) {
+        T* const p = try_allocate<T>(s);
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    // ------------
+    // try_allocate
+    // ------------
+
+    /**
+     * O(1) in space
+     * allocate, but return nullptr if there isn't an acceptable free block
+     */
+    template <typename T = char>
+    T* try_allocate (size_type s) {
+        static_assert(Align >= alignof(T), "Align must be at least alignof(T)");
+        tag_type size_in_bytes = block_of<T>(s);
+        if (size_in_bytes == -1)
+            return nullptr;
 
+        const tag_type i = place(size_in_bytes);
+        if (i == -1)
+            return nullptr;
+        _stats.padding += size_in_bytes - s * sizeof(T);
+        touched(i);
+        audit();
+        return reinterpret_cast<T*>(&a[pad + i + word]);
+    }
+
+    // ----------
+    // deallocate
+    // ----------
+
+    /**
+     * O(1) in space
+     * O(b) in time, b the number of free blocks in the bin of the coalesced block, if ordered
+     * O(1) in time otherwise
+     * After deallocation adjacent free blocks must be coalesced.
+     * With deferral on, a small block is held instead, see Deferral.
+     * On a hardened heap, the block goes into the quarantine instead, and
+     * the oldest block there, if it is full, is freed in its place; then
+     * the next block of the patrol is checked, see patrol().
+     * Throw an invalid_argument exception, if p is invalid.
+     * Throw a Heap_Error exception, if the block's canary was overwritten,
+     * or the block leaving the quarantine was written after it was freed.
+     */
+    void deallocate(const void* p, size_type) {
+        tag_type index = live_block(p);
+        if constexpr (hardened && (quarantined != 0)) {
+            const tag_type i = index;
+            if ((index = quarantine(i)) == -1) {
+                --_stats.busy_blocks;
+                ++_stats.deallocations;
+                touched(i);
+                audit();
+                patrol(1);
+                return;
+            }
+        }
+        --_stats.busy_blocks;
+        ++_stats.deallocations;
+        const tag_type size = size_of(index);
+        if (size <= static_cast<tag_type>(_deferral.largest)) {
+            hold(index);
+            if ((_stats.held_blocks > _deferral.hold) || (_stats.busy_blocks == 0))
+                consolidate();
+            else
+                touched(index);
+        }
+        else
+            touched(release(index, size));
+        audit();
+        if constexpr (hardened)
+            patrol(1);
+    }
+
+    // --------------
+    // allocate_batch
+    // --------------
+
+    /**
+     * O(1) in space
+     * O(k) allocations, k the number of requests, and one validity check
+     * out[i] becomes a block of sizes[i] objects, placed as allocate would
+     * each request is its own search of the bins, so the batch saves only
+     * the validity checks, one for the whole batch instead of one each
+     * throw a std::bad_alloc exception, if there isn't an acceptable free
+     * block for any of them, after deallocating those already placed
+     * P is a T* or an offset_ptr<T>
+     */
+    template <typename P>
+    void allocate_batch (std::span<const size_type> sizes, std::span<P> out) {
+        using T = typename std::pointer_traits<P>::element_type;
+        static_assert(Align >= alignof(T), "Align must be at least alignof(T)");
+        assert(out.size() >= sizes.size());
+        size_type k = 0;
+        for (; k != sizes.size(); ++k) {
+            const tag_type size_in_bytes = block_of<T>(sizes[k]);
+            const tag_type i = (size_in_bytes == -1) ? -1 : place(size_in_bytes);
+            if (i == -1)
+                break;
+            _stats.padding += size_in_bytes - sizes[k] * sizeof(T);
+            out[k] = P(reinterpret_cast<T*>(&a[pad + i + word]));
+        }
+        if (k != sizes.size()) {
+            while (k != 0) {
+                const tag_type index = busy_block(std::to_address(out[--k]));
+                touched(release(index, size_of(index)));
+                --_stats.busy_blocks;
+                ++_stats.deallocations;
+            }
+            audit();
+            throw std::bad_alloc();
+        }
+        for (k = 0; k != sizes.size(); ++k)
+            touched(busy_block(std::to_address(out[k])));
+        audit();
+    }
+
+    // ----------------
+    // deallocate_batch
+    // ----------------
+
+    /**
+     * O(1) in space
+     * O(k log k) in time, k the number of pointers, to sort ptrs by address,
+     * then one sweep in which blocks that are next to each other are merged
+     * before being coalesced with their free neighbors, and one validity check
+     * ptrs is left sorted
+     * on a hardened heap, every block goes into the quarantine, as deallocate
+     * sends it, and only the blocks pushed out of it are coalesced, one at a
+     * time, then the next block of the patrol is checked
+     * throw an invalid_argument exception, if any pointer is invalid,
+     * repeated, or of a block already freed, one held by deferral included,
+     * before deallocating any of them
+     * throw a Heap_Error exception, if any canary was overwritten, or any
+     * block to be pushed out of the quarantine was written after it was
+     * freed, before deallocating any of them
+     * P is a T* or an offset_ptr<T>
+     */
+    template <typename P>
+    void deallocate_batch (std::span<P> ptrs) {
+        std::sort(ptrs.begin(), ptrs.end());
+        for (size_type k = 0; k != ptrs.size(); ++k) {
+            live_block(std::to_address(ptrs[k]));
+            if ((k != 0) && (ptrs[k] == ptrs[k - 1]))
+                throw std::invalid_argument("Block is already free");
+        }
+        if constexpr (hardened && (quarantined != 0)) {
+            // the blocks quarantined before the batch that it pushes out are
+            // inspected first, the batch's own are intact
+            const size_type out = std::min<size_type>(_held, std::max<size_type>(_held + ptrs.size(), quarantined) - quarantined);
+            for (size_type k = 0; k != out; ++k)
+                inspect(_quarantine[(_oldest + k) % quarantined]);
+            for (size_type k = 0; k != ptrs.size(); ++k)
+                if (const tag_type j = quarantine(busy_block(std::to_address(ptrs[k]))); j != -1)
+                    touched(release(j, size_of(j)));
+        }
+        else {
+            size_type k = 0;
+            while (k != ptrs.size()) {
+                const tag_type index = busy_block(std::to_address(ptrs[k]));
+                tag_type       end   = next_block(index);
+                while ((++k != ptrs.size()) && (busy_block(std::to_address(ptrs[k])) == end)) {
+                    end = next_block(end);
+                    ++_stats.coalesces;
+                }
+                touched(release(index, end - index - over));
+            }
+        }
+        _stats.busy_blocks   -= ptrs.size();
+        _stats.deallocations += ptrs.size();
+        audit();
+        if constexpr (hardened)
+            patrol(1);
+    }
+
+
+    // ----------
+    // reallocate
+    // ----------
+
+    /**
+     * O(1) in space
+     * O(1) in time, in place
+     * resize the block at p from old_n to new_n objects
+     * shrinking splits off the tail, which is coalesced with a free successor
+     * growing first absorbs a free successor, when that is enough
+     * otherwise new_n objects are allocated, the first min(old_n, new_n)
+     * objects are moved there and destroyed, and the block at p is deallocated
+     * the objects past new_n must already be destroyed when shrinking
+     * throw a std::bad_alloc exception, if there isn't an acceptable free block,
+     * leaving the block at p as it was
+     * throw an invalid_argument exception, if p is invalid
+     * throw a Heap_Error exception, if the canary of p's block was overwritten
+     */
+    template <typename T>
+    T* reallocate (T* p, size_type old_n, size_type new_n) {
+        const tag_type index = live_block(p);
+        const tag_type size  = size_of(index);
+        const tag_type want  = block_of<T>(new_n);
+        if (want == -1)
+            throw std::bad_alloc();
+
+        tag_type next_index = index + size + over;
+        bool     next_free  = (next_index < static_cast<tag_type>(bytes)) && ((*this)[next_index] > 0);
+
+        if (want <= size) {
+            tag_type remaining = size - want - over;
+            if (remaining >= least) {
+                // Split off the tail, coalescing it with the next block if free
+                tag_type tail_index = index + over + want;
+                tag(index, -want);
+                if (next_free) {
+                    tag_type next_size = (*this)[next_index];
+                    rebin(next_index, next_size, tail_index, remaining + next_size + over);
+                } else {
+                    tag(tail_index, remaining);
+                    insert(tail_index);
+                }
+                merged(tail_index, next_block(tail_index));
+                if constexpr (hardened)
+                    (*this)[index + want] = canary(index);
+                ++_stats.splits;
+                _stats.coalesces += next_free;
+            }
+            ++_stats.reallocations;
+            touched(index);
+            audit();
+            return p;
+        }
+
+        if (next_free && (size + over + (*this)[next_index] >= want)) {
+            // Absorb the next block, what is left of it stays free
+            tag_type next_size = (*this)[next_index];
+            tag_type remaining = size + next_size - want;
+            if (remaining >= least) {
+                rebin(next_index, next_size, index + over + want, remaining);
+                tag(index, -want);
+                ++_stats.splits;
+            } else {
+                unlink(next_index, bin(next_size));
+                tag(index, -(size + next_size + over));
+            }
+            merged(index, next_index + next_size + over);
+            if constexpr (hardened)
+                (*this)[index + size_of(index)] = canary(index);
+            ++_stats.coalesces;
+            ++_stats.reallocations;
+            touched(index);
+            audit();
+            return p;
+        }
+
+        T* const q = allocate<T>(new_n);
+        const size_type n = std::min(old_n, new_n);
+        size_type k = 0;
+        try {
+            for (; k != n; ++k)
+                new (q + k) T(std::move_if_noexcept(p[k]));
+        }
+        catch (...) {
+            while (k != 0)
+                q[--k].~T();
+            deallocate(q, new_n);
+            throw;
+        }
+        for (k = 0; k != n; ++k)
+            p[k].~T();
+        deallocate(p, old_n);
+        ++_stats.reallocations;
+        return q;
+    }
+
+    // --------
+    // capacity
+    // --------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the number of objects the busy block at p can hold, at least as many
+     * as were asked for, short of its canary on a hardened heap
+     * throw an invalid_argument exception, if p is invalid
+     */
+    template <typename T>
+    size_type capacity (const T* p) const {
+        return (size_of(busy_block(p)) - guard) / sizeof(T);
+    }
+
+    // -----
+    // empty
+    // -----
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * true iff no block is allocated, that is the heap is one free block
+     */
+    bool empty () const {
+        return (*this)[0] == static_cast<tag_type>(bytes) - over;
+    }
+
+    // -----
+    // stats
+    // -----
+
+    /**
+     * O(1) in space
+     * O(1) in time, but for the largest free block, found in O(b), b the
+     * number of free blocks in the largest size class that isn't empty
+     * occupancy and fragmentation now, and counters since construction
+     * internal fragmentation is over every block allocated, since a block
+     * doesn't remember the size asked for
+     */
+    Heap_Stats stats () const {
+        Heap_Stats r = _stats;
+        r.live_bytes = bytes - over * (r.busy_blocks + r.free_blocks + r.held_blocks) - r.free_bytes - r.held_bytes;
+        if (_map != 0) {
+            const int b = 63 - std::countl_zero(_map);
+            for (tag_type i = _bin[b]; i != -1; i = next_free(i))
+                r.largest_free = std::max<std::size_t>(r.largest_free, (*this)[i]);
+        }
+        if (r.free_bytes != 0)
+            r.external = 1.0 - static_cast<double>(r.largest_free) / r.free_bytes;
+        if (r.allocated != 0)
+            r.internal = static_cast<double>(r.padding + r.unsplit) / r.allocated;
+        return r;
+    }
+
+    // -----------
+    // check_level
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * how much of the heap is checked after each operation
+     * Check::touched by default, Check::off if NDEBUG is defined
+     */
+    Check check_level () const {
+        return _check;
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * check the heap at the given level from now on, every period-th
+     * operation for Check::sampled
+     */
+    void check_level (Check level, unsigned period = 64) {
+        assert(period > 0);
+        _check  = level;
+        _period = period;
+    }
+
+    // --------
+    // deferral
+    // --------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * which freed blocks are held instead of coalesced, and how many
+     */
+    Deferral deferral () const {
+        return _deferral;
+    }
+
+    /**
+     * O(1) in space
+     * O(h) in time, h the number of held blocks, which are coalesced first
+     * hold freed blocks as d says from now on
+     */
+    void deferral (const Deferral& d) {
+        consolidate();
+        _deferral.largest = std::min<std::size_t>(d.largest, 255);
+        _deferral.hold    = d.hold;
+    }
+
+    // -----------
+    // consolidate
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(h) deallocations, h the number of held blocks
+     * coalesce every held block with its free neighbors, emptying the
+     * quarantine too on a hardened heap
+     * throw a Heap_Error exception, if a quarantined block was written after
+     * it was freed, leaving it and those after it in the quarantine
+     */
+    void consolidate () {
+        if (_stats.held_blocks == 0)
+            return;
+        if constexpr (hardened && (quarantined != 0)) {
+            for (; _held != 0; --_held, _oldest = (_oldest + 1) % quarantined) {
+                const tag_type j = _quarantine[_oldest];
+                inspect(j);
+                --_stats.held_blocks;
+                _stats.held_bytes -= size_of(j);
+                release(j, size_of(j));
+            }
+        }
+        for (int b = 0; b != 32; ++b) {
+            tag_type i = _quick[b];
+            _quick[b] = -1;
+            while (i != -1) {
+                const tag_type next = (*this)[i + word];
+                release(i, size_of(i));
+                i = next;
+            }
+        }
+        _stats.held_blocks = 0;
+        _stats.held_bytes  = 0;
+        ++_stats.consolidations;
+    }
+
+    // ------
+    // patrol
+    // ------
+
+    /**
+     * O(1) in space
+     * O(n) in time
+     * check the next n blocks, as check_heap() checks each, going on from
+     * where the last patrol stopped and wrapping around at the end, so that
+     * a hardened heap finds an overwritten canary even if its block is never
+     * freed; a hardened heap patrols one block on every deallocation
+     * throw a Heap_Error exception, if one is corrupt
+     */
+    void patrol (int n) {
+        for (; n > 0; --n) {
+            Heap_Report r;
+            if ((r.error = check_block(_patrol)) != nullptr) {
+                r.index = _patrol;
+                throw Heap_Error(r);
+            }
+            _patrol = next_block(_patrol);
+            if (_patrol >= static_cast<tag_type>(bytes))
+                _patrol = 0;
+        }
+    }
+
+    // ----------
+    // check_heap
+    // ----------
+
+    /**
+     * O(1) in space
+     * O(n) in time
+     * walk every block and every bin, and report the first corruption found
+     * besides the checks on each block, every bin must list exactly its free
+     * blocks, in address order for First_Fit and Next_Fit, the map must
+     * mark exactly the bins that aren't empty, every quick list must hold
+     * busy blocks of its size, every quarantined block must be intact, and
+     * the counters of stats() must agree with the blocks
+     */
+    Heap_Report check_heap () const {
+        Heap_Report r;
+        long     free = 0;
+        tag_type i    = 0;
+        while (i < static_cast<tag_type>(bytes)) {
+            if ((r.error = check_block(i)) != nullptr) {
+                r.index = i;
+                return r;
+            }
+            ++r.blocks;
+            const tag_type v = (*this)[i];
+            if (v > 0) {
+                ++free;
+                r.free += v;
+            }
+            i = next_block(i);
+        }
+        for (int b = 0; b != 64; ++b) {
+            r.bin = b;
+            if ((_bin[b] != -1) != (((_map >> b) & 1) != 0)) {
+                r.error = "bin map out of date";
+                return r;
+            }
+            std::uint32_t count = 0;
+            for (tag_type j = _bin[b], prev = -1; j != -1; prev = j, j = next_free(j)) {
+                r.index = j;
+                if (!boundary(j) || ((*this)[j] <= 0))
+                    r.error = "bin holds a block that isn't free";
+                else if (bin((*this)[j]) != b)
+                    r.error = "free block in the wrong bin";
+                else if (ordered && (j < prev))
+                    r.error = "bin out of address order";
+                else if (--free < 0)
+                    r.error = "bins hold more blocks than are free";
+                if (r.error != nullptr)
+                    return r;
+                ++count;
+            }
+            r.index = -1;
+            if (count != _stats.histogram[b]) {
+                r.error = "stats out of date";
+                return r;
+            }
+        }
+        std::size_t held       = 0;
+        std::size_t bytes_held = 0;
+        for (int b = 0; b != 32; ++b) {
+            r.bin = b;
+            for (tag_type j = _quick[b]; j != -1; j = (*this)[j + word]) {
+                r.index = j;
+                if (!boundary(j) || ((*this)[j] >= 0))
+                    r.error = "quick list holds a block that isn't busy";
+                else if (bin(size_of(j)) != b)
+                    r.error = "held block on the wrong quick list";
+                else if (++held > _stats.held_blocks)
+                    r.error = "quick lists hold more blocks than are held";
+                if (r.error != nullptr)
+                    return r;
+                bytes_held += size_of(j);
+            }
+        }
+        r.bin = -1;
+        if constexpr (hardened && (quarantined != 0)) {
+            for (unsigned k = 0; k != _held; ++k) {
+                const tag_type j = _quarantine[(_oldest + k) % quarantined];
+                r.index = j;
+                if (!boundary(j) || ((*this)[j] >= 0))
+                    r.error = "quarantine holds a block that isn't busy";
+                else if (!intact(j))
+                    r.error = "block written after it was freed";
+                if (r.error != nullptr)
+                    return r;
+                ++held;
+                bytes_held += size_of(j);
+            }
+        }
+        r.index = -1;
+        if (free != 0)
+            r.error = "free block missing from the bins";
+        else if ((static_cast<std::size_t>(r.free) != _stats.free_bytes) ||
+                 (static_cast<std::size_t>(r.blocks) != _stats.busy_blocks + _stats.free_blocks + held) ||
+                 (held != _stats.held_blocks) || (bytes_held != _stats.held_bytes))
+            r.error = "stats out of date";
+        return r;
+    }
+
+    // -------
+    // handles
+    // -------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the offset of p, a pointer into the heap, which finds the same object
+     * in a copy of the heap saved, loaded, or mapped anywhere else
+     */
+    tag_type offset_of (const void* p) const {
+        return static_cast<tag_type>(static_cast<const char*>(p) - &a[pad]);
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the object of type T at offset k, an offset_of() one
+     */
+    template <typename T>
+    T* at (tag_type k) {
+        return reinterpret_cast<T*>(&a[pad + k]);
+    }
+
+    template <typename T>
+    const T* at (tag_type k) const {
+        return reinterpret_cast<const T*>(&a[pad + k]);
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the offset of the object from which the others can be found, kept
+     * with the heap, so that a process that loads or maps it finds its
+     * objects again, -1 if none
+     */
+    tag_type root () const {
+        return _root;
+    }
+
+    void root (tag_type k) {
+        _root = k;
+    }
+
+    // ----
+    // save
+    // ----
+
+    /**
+     * O(1) in space
+     * O(n) in time
+     * write the heap to the file at path, which is replaced only once the
+     * whole heap is written
+     * throw a runtime_error exception, if path can't be written
+     */
+    void save (const char* path) const {
+        Heap_Image h = header();
+        h.clean    = 1;
+        h.checksum = fingerprint(this, sizeof(My_Heap));
+        const std::string temporary = std::string(path) + ".tmp";
+        const int         fd        = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1)
+            throw std::runtime_error("Cannot write heap");
+        const bool written = transfer(pwrite, fd, reinterpret_cast<const char*>(&h), sizeof(h), 0) &&
+                             transfer(pwrite, fd, reinterpret_cast<const char*>(this), sizeof(My_Heap), image) &&
+                             (fsync(fd) == 0);
+        if ((close(fd) != 0) || !written || (std::rename(temporary.c_str(), path) != 0)) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Cannot write heap");
+        }
+    }
+
+    // ----
+    // load
+    // ----
+
+    /**
+     * O(n) in space
+     * O(n) in time
+     * replace the heap with the one saved at path, so that every object of
+     * that one is at the offset it had, and every block of this one is gone
+     * the check level stays this heap's
+     * throw a runtime_error exception, if path can't be read
+     * throw an invalid_argument exception, if it isn't a heap of this type,
+     * or its checksum doesn't match
+     * throw a Heap_Error exception, if the heap is corrupt nonetheless
+     * the heap is unchanged, if it throws
+     */
+    void load (const char* path) {
+        const int fd = open(path, O_RDONLY);
+        if (fd == -1)
+            throw std::runtime_error("Cannot read heap");
+        const std::unique_ptr<My_Heap> that = std::make_unique<My_Heap>();
+        Heap_Image h;
+        const bool read = transfer(pread, fd, reinterpret_cast<char*>(&h), sizeof(h), 0) &&
+                          matches(h) &&
+                          transfer(pread, fd, reinterpret_cast<char*>(that.get()), sizeof(My_Heap), image);
+        close(fd);
+        if (!read || (h.checksum != fingerprint(that.get(), sizeof(My_Heap))))
+            throw std::invalid_argument("Invalid heap");
+        const Heap_Report r = that->check_heap();
+        if (!r)
+            throw Heap_Error(r);
+        that->_check  = _check;
+        that->_period = _period;
+        that->_tick   = _tick;
+        std::memcpy(static_cast<void*>(this), that.get(), sizeof(My_Heap));
+    }
+
+    // ---
+    // map
+    // ---
+
+    /**
+     * O(1) in space
+     * O(n) in time, to check the heap
+     * the heap in the file at path, mapped shared, so that every change to
+     * the heap is a change to the file, which is created with a new heap if
+     * it is missing or empty; the file's checksum is brought up to date
+     * when the last pointer to the heap is gone, and the heap unmapped
+     * a heap that was never unmapped, because its process died, has its
+     * blocks checked instead of its checksum
+     * one mapping at a time, in any process, may be alive: the file is
+     * locked with flock until the heap is unmapped
+     * throw a runtime_error exception, if path can't be opened or mapped,
+     * or it is already mapped
+     * throw an invalid_argument exception, if it isn't a heap of this type,
+     * or its checksum doesn't match
+     * throw a Heap_Error exception, if the heap is corrupt
+     */
+    static std::shared_ptr<My_Heap> map (const char* path) {
+        const std::size_t length = image + sizeof(My_Heap);
+        const int         fd     = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd == -1)
+            throw std::runtime_error("Cannot map heap");
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            const bool mapped = (errno == EWOULDBLOCK); // before close can change errno
+            close(fd);
+            throw std::runtime_error(mapped ? "Heap is already mapped" : "Cannot map heap");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot map heap");
+        }
+        const bool fresh = (st.st_size == 0);
+        if (!fresh && (static_cast<std::size_t>(st.st_size) != length)) {
+            close(fd);
+            throw std::invalid_argument("Invalid heap");
+        }
+        if (fresh && (ftruncate(fd, length) != 0)) {
+            close(fd);
+            throw std::runtime_error("Cannot map heap");
+        }
+        void* m = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (m == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map heap");
+        }
+        Heap_Image& h = *static_cast<Heap_Image*>(m);
+        My_Heap*    p = reinterpret_cast<My_Heap*>(static_cast<char*>(m) + image);
+        try {
+            if (reinterpret_cast<std::uintptr_t>(p) % Align != 0)
+                throw std::invalid_argument("Align exceeds the page size");
+            if (fresh) {
+                new (p) My_Heap; // this is correct and exempt from the prohibition of new
+                h = header();
+            }
+            else {
+                if (!matches(h) || ((h.clean == 1) && (h.checksum != fingerprint(p, sizeof(My_Heap)))))
+                    throw std::invalid_argument("Invalid heap");
+                const Heap_Report r = p->check_heap();
+                if (!r)
+                    throw Heap_Error(r);
+            }
+        }
+        catch (...) {
+            munmap(m, length);
+            close(fd);
+            throw;
+        }
+        h.clean = 0;
+        msync(m, sizeof(h), MS_SYNC);
+        return std::shared_ptr<My_Heap>(p, [m, length, fd] (My_Heap* q) {
+            Heap_Image& h = *static_cast<Heap_Image*>(m);
+            h.checksum = fingerprint(q, sizeof(My_Heap));
+            h.clean    = 1;
+            msync(m, length, MS_SYNC);
+            munmap(m, length);
+            close(fd); // and with it the lock
+        });
+    }
+
+    // -----------
+    // operator []
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     */
+    tag_type& operator [] (tag_type i) { // this is correct
+        return *reinterpret_cast<tag_type*>(&a[pad + i]);
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     */
+    const tag_type& operator [] (tag_type i) const { // this is correct
+        return *reinterpret_cast<const tag_type*>(&a[pad + i]);
+    }
+
+    // -----
+    // begin
+    // -----
+
+    iterator begin () { // this is correct
+        return iterator(*this, 0);
+    }
+
+    const_iterator begin () const { // this is correct
+        return const_iterator(*this, 0);
+    }
+
+    // ---
+    // end
+    // ---
+
+    iterator end () { // this is correct
+        return iterator(*this, bytes);
+    }
+
+    const_iterator end () const { // this is correct
+        return const_iterator(*this, bytes);
+    }
+};
+
+// ------------
+// My_Allocator
+// ------------
+
+/**
+ * a handle to a My_Heap, which copies and rebound copies share: two
+ * allocators are equal iff they share a heap, and the heap lives until the
+ * last allocator sharing it is gone
+ * containers carry their allocator along when they are copied, moved, or
+ * swapped, so their blocks always go back to the heap they came from
+ * with a Relocatable policy, its pointers are offset_ptrs and it doesn't
+ * own its heap, which must outlive it, see Relocatable
+ */
+template <typename T, std::size_t N, typename Policy = First_Fit, std::size_t Align = 8>
+class My_Allocator {
+    static_assert(Align >= alignof(T), "Align must be at least alignof(T)");
+
+    template <typename, std::size_t, typename, std::size_t>
+    friend class My_Allocator;
+
+    // -----------
+    // operator ==
+    // -----------
+
+    template <typename U>
+    friend bool operator == (const My_Allocator& lhs, const My_Allocator<U, N, Policy, Align>& rhs) {
+        return &lhs.heap() == &rhs.heap();
+    }
+
+    // -----------
+    // operator !=
+    // -----------
+
+    template <typename U>
+    friend bool operator != (const My_Allocator& lhs, const My_Allocator<U, N, Policy, Align>& rhs) {
+        return !(lhs == rhs);
+    }
+
+    static constexpr bool relocatable = Layout_Of<Policy>::relocatable;
+
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using heap_type       = My_Heap<N, Policy, Align>;
+
+    using value_type      = T;
+
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using pointer         = std::conditional_t<relocatable, offset_ptr<value_type>,       value_type*>;
+    using const_pointer   = std::conditional_t<relocatable, offset_ptr<const value_type>, const value_type*>;
+
+    using reference       =       value_type&;
+    using const_reference = const value_type&;
+
+    using iterator        = typename heap_type::iterator;
+    using const_iterator  = typename heap_type::const_iterator;
+    using tag_type        = typename heap_type::tag_type;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+    using is_always_equal                        = std::false_type;
+
+    template <typename U>
+    struct rebind {
+        using other = My_Allocator<U, N, Policy, Align>;
+    };
+
+private:
+    // ----
+    // data
+    // ----
+
+    using handle_type = std::conditional_t<relocatable, offset_ptr<heap_type>, std::shared_ptr<heap_type>>;
+
+    handle_type _h;
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * a handle to h that doesn't own it
+     */
+    static handle_type handle (heap_type& h) noexcept {
+        if constexpr (relocatable)
+            return &h;
+        else
+            return std::shared_ptr<heap_type>(std::shared_ptr<heap_type>(), &h);
+    }
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * a new heap
+     * throw a std::bad_alloc exception, if N is less than one aligned block
+     */
+    My_Allocator () requires (!relocatable) :
+            _h (std::make_shared<heap_type>())
+    {}
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the heap h, which must outlive every allocator sharing it
+     */
+    explicit My_Allocator (heap_type& h) noexcept :
+            _h (handle(h))
+    {}
+
+    /**
+     * O(1) in space
+     * O(n) in time, to check the heap
+     * the heap mapped from the file at path, created if it is missing, see My_Heap::map()
+     */
+    explicit My_Allocator (const char* path) requires (!relocatable) :
+            _h (heap_type::map(path))
+    {}
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the heap of that, for another type
+     */
+    template <typename U>
+    My_Allocator (const My_Allocator<U, N, Policy, Align>& that) noexcept :
+            _h (that._h)
+    {}
+
+    // a move copies, so that the allocator moved from still has its heap
+    My_Allocator             (const My_Allocator&) = default;
+    ~My_Allocator            ()                    = default;
+    My_Allocator& operator = (const My_Allocator&) = default;
+
+    // ----
+    // heap
+    // ----
+
+    heap_type& heap () const {
+        return *_h;
+    }
+
+    // --------
+    // block_of
+    // --------
+
+    static tag_type block_of (size_type s) {
+        return heap_type::template block_of<T>(s);
+    }
+
+    // --------
+    // allocate
+    // --------
+
+    pointer allocate (size_type s) {
+        return pointer(_h->template allocate<T>(s));
+    }
+
+    pointer try_allocate (size_type s) {
+        return pointer(_h->template try_allocate<T>(s));
+    }
+
+    // ---------
+    // construct
+    // ---------
+
+    template <typename U, typename... Args>
+    void construct (U* p, Args&&... args) { // this is correct and exempt
+        new (p) U(std::forward<Args>(args)...); // from the prohibition of new
+        _h->audit();
+    }
+
+    // ----------
+    // deallocate
+    // ----------
+
+    void deallocate (pointer p, size_type s) {
+        _h->deallocate(std::to_address(p), s);
+    }
+
+    // -----
+    // batch
+    // -----
+
+    void allocate_batch (std::span<const size_type> sizes, std::span<pointer> out) {
+        _h->allocate_batch(sizes, out);
+    }
+
+    void deallocate_batch (std::span<pointer> ptrs) {
+        _h->deallocate_batch(ptrs);
+    }
+
+    // ----------
+    // reallocate
+    // ----------
+
+    pointer reallocate (pointer p, size_type old_n, size_type new_n) {
+        return pointer(_h->reallocate(std::to_address(p), old_n, new_n));
+    }
+
+    // -------
+    // destroy
+    // -------
+
+    template <typename U>
+    void destroy (U* p) { // this is correct
+        p->~U();
+        _h->audit();
+    }
+
+    // ---------------------
+    // forwarded to the heap
+    // ---------------------
+
+    size_type capacity (const_pointer p) const {
+        return _h->capacity(std::to_address(p));
+    }
+
+    bool empty () const {
+        return _h->empty();
+    }
+
+    Heap_Stats stats () const {
+        return _h->stats();
+    }
+
+    Check check_level () const {
+        return _h->check_level();
+    }
+
+    void check_level (Check level, unsigned period = 64) {
+        _h->check_level(level, period);
+    }
+
+    Deferral deferral () const {
+        return _h->deferral();
+    }
+
+    void deferral (const Deferral& d) {
+        _h->deferral(d);
+    }
+
+    void consolidate () {
+        _h->consolidate();
+    }
+
+    void patrol (int n) {
+        _h->patrol(n);
+    }
+
+    Heap_Report check_heap () const {
+        return _h->check_heap();
+    }
+
+    tag_type offset_of (const void* p) const {
+        return _h->offset_of(p);
+    }
+
+    pointer at (tag_type k) const {
+        return pointer(_h->template at<T>(k));
+    }
+
+    tag_type root () const {
+        return _h->root();
+    }
+
+    void root (tag_type k) {
+        _h->root(k);
+    }
+
+    void save (const char* path) const {
+        _h->save(path);
+    }
+
+    void load (const char* path) {
+        _h->load(path);
+    }
+
+    tag_type& operator [] (tag_type i) {
+        return (*_h)[i];
+    }
+
+    const tag_type& operator [] (tag_type i) const {
+        return std::as_const(*_h)[i];
+    }
+
+    iterator begin () {
+        return _h->begin();
+    }
+
+    const_iterator begin () const {
+        return std::as_const(*_h).begin();
+    }
+
+    iterator end () {
+        return _h->end();
+    }
+
+    const_iterator end () const {
+        return std::as_const(*_h).end();
+    }
+};
+
+// -----------
+// My_Resource
+// -----------
+
+/**
+ * a std::pmr::memory_resource on the heap of a My_Allocator, which it may
+ * share with allocators
+ * a block aligned to a, more strictly than Align, is allocated a - Align
+ * larger and the aligned address in it returned, with its distance from
+ * the start of the block two ints before it and INT_MIN just before it,
+ * where an unshifted block has its header, which is never INT_MIN, busy or
+ * free (with Wide sentinels, that int is the header's high half, on a
+ * little-endian machine)
+ * in Resource_Mode::arena, blocks are carved out of runs taken from the
+ * heap, each at least twice as large as the one before, deallocate does
+ * nothing, and release() gives every run back to the heap in one batch
+ * two resources are equal iff they are the same one, or both free each
+ * block on deallocate into the same heap
+ */
+template <std::size_t N, typename Policy = First_Fit, std::size_t Align = 16>
+class My_Resource : public std::pmr::memory_resource {
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using allocator_type = My_Allocator<char, N, Policy, Align>;
+    using heap_type      = typename allocator_type::heap_type;
+    using size_type      = std::size_t;
+
+private:
+    // ----
+    // data
+    // ----
+
+    static constexpr size_type first_run = 1024;
+
+    allocator_type     _a;
+    Resource_Mode      _mode;
+    std::vector<char*> _runs; // taken from the heap, in arena mode
+    char*              _next; // first free byte of the last run
+    char*              _end;  // end of the last run
+
+    /**
+     * a block of n bytes aligned to a, more than Align, from the heap
+     * throw a std::bad_alloc exception, if there isn't an acceptable free block
+     */
+    char* allocate_aligned (size_type n, size_type a) {
+        char* const          p = _a.allocate(n + a - Align);
+        const std::uintptr_t b = reinterpret_cast<std::uintptr_t>(p);
+        char* const          q = p + (((b + a - 1) & ~std::uintptr_t(a - 1)) - b);
+        if (q != p) {
+            reinterpret_cast<int*>(q)[-2] = static_cast<int>(q - p);
+            reinterpret_cast<int*>(q)[-1] = INT_MIN;
+        }
+        return q;
+    }
+
+    /**
+     * the start of the heap block of q, which was aligned to a
+     */
+    static char* block (void* q, size_type a) {
+        if (a <= Align)
+            return static_cast<char*>(q);
+        const int* t = static_cast<int*>(q);
+        return static_cast<char*>(q) - ((t[-1] == INT_MIN) ? t[-2] : 0);
+    }
+
+    /**
+     * carve n bytes aligned to a out of the last run, or out of a new one
+     * a new run is twice the last one, or just large enough for n if the
+     * heap has no room for that
+     * throw a std::bad_alloc exception, if the heap has no room for n
+     */
+    char* carve (size_type n, size_type a) {
+        for (int k = 0; k != 2; ++k) {
+            if (_next != nullptr) {
+                const std::uintptr_t b = reinterpret_cast<std::uintptr_t>(_next);
+                char* const          q = _next + (((b + a - 1) & ~std::uintptr_t(a - 1)) - b);
+                if ((q <= _end) && (static_cast<size_type>(_end - q) >= n)) {
+                    _next = q + n;
+                    return q;
+                }
+            }
+            const size_type need = n + ((a > Align) ? a - Align : 0);
+            const size_type last = _runs.empty() ? first_run / 2 : _a.capacity(_runs.back());
+            char*           r    = (last * 2 >= need) ? _a.try_allocate(last * 2) : nullptr;
+            if (r == nullptr)
+                r = _a.allocate(need);
+            _runs.push_back(r);
+            _next = r;
+            _end  = r + _a.capacity(r);
+        }
+        throw std::bad_alloc();
+    }
+
+    // -------------------------
+    // std::pmr::memory_resource
+    // -------------------------
+
+    void* do_allocate (size_type n, size_type a) override {
+        n = std::max<size_type>(n, 1);
+        if (_mode == Resource_Mode::arena)
+            return carve(n, a);
+        if (a > Align)
+            return allocate_aligned(n, a);
+        return _a.allocate(n);
+    }
+
+    void do_deallocate (void* p, size_type n, size_type a) override {
+        if (_mode == Resource_Mode::heap)
+            _a.deallocate(block(p, a), n);
+    }
+
+    bool do_is_equal (const std::pmr::memory_resource& that) const noexcept override {
+        if (this == &that)
+            return true;
+        const My_Resource* r = dynamic_cast<const My_Resource*>(&that);
+        return (r != nullptr) && (_mode == Resource_Mode::heap) && (r->_mode == Resource_Mode::heap) && (_a == r->_a);
+    }
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * a resource on a new heap
+     */
+    explicit My_Resource (Resource_Mode m = Resource_Mode::heap) :
+            My_Resource (allocator_type(), m)
+    {}
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * a resource on the heap of a
+     */
+    explicit My_Resource (const allocator_type& a, Resource_Mode m = Resource_Mode::heap) :
+            _a    (a),
+            _mode (m),
+            _next (nullptr),
+            _end  (nullptr)
+    {}
+
+    My_Resource             (const My_Resource&) = delete;
+    My_Resource& operator = (const My_Resource&) = delete;
+
+    /**
+     * O(r) in time, r the number of runs, in arena mode
+     * a corrupt heap, which release() would throw on, keeps the runs
+     */
+    ~My_Resource () override {
+        try {
+            release();
+        }
+        catch (const std::logic_error&)
+            {}
+    }
+
+    // -------
+    // release
+    // -------
+
+    /**
+     * O(r log r) in time, r the number of runs
+     * in arena mode, give every run back to the heap, with every block
+     * carved out of it
+     * nothing in heap mode
+     */
+    void release () {
+        if (_runs.empty())
+            return;
+        _a.deallocate_batch(_runs);
+        _runs.clear();
+        _next = nullptr;
+        _end  = nullptr;
+    }
+
+    // ----
+    // mode
+    // ----
+
+    Resource_Mode mode () const {
+        return _mode;
+    }
+
+    // ---------
+    // allocator
+    // ---------
+
+    /**
+     * the allocator whose heap this resource is on
+     */
+    const allocator_type& allocator () const {
+        return _a;
+    }
+
+    // ----
+    // runs
+    // ----
+
+    /**
+     * the number of runs taken from the heap, in arena mode
+     */
+    size_type runs () const {
+        return _runs.size();
+    }
+};
+
+// ----------------
+// Locked_Allocator
+// ----------------
+
+/**
+ * a My_Heap behind one mutex
+ * copies share the heap and the mutex
+ */
+template <typename T, std::size_t N, typename Policy = First_Fit, std::size_t Align = 8>
+class Locked_Allocator {
+    // -----------
+    // operator ==
+    // -----------
+
+    friend bool operator == (const Locked_Allocator& lhs, const Locked_Allocator& rhs) {
+        return lhs._s == rhs._s;
+    }
+
+    // -----------
+    // operator !=
+    // -----------
+
+    friend bool operator != (const Locked_Allocator& lhs, const Locked_Allocator& rhs) {
+        return !(lhs == rhs);
+    }
+
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using heap_type       = My_Heap<N, Policy, Align>;
+
+    using value_type      = T;
+
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using pointer         =       value_type*;
+    using const_pointer   = const value_type*;
+
+    using reference       =       value_type&;
+    using const_reference = const value_type&;
+
+private:
+    // ----
+    // data
+    // ----
+
+    struct shared {
+        std::mutex lock;
+        heap_type  heap;
+    };
+
+    std::shared_ptr<shared> _s;
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    Locked_Allocator () :
+            _s (std::make_shared<shared>())
+    {}
+
+    // --------
+    // allocate
+    // --------
+
+    pointer allocate (size_type s) {
+        std::lock_guard<std::mutex> guard(_s->lock);
+        return _s->heap.template allocate<T>(s);
+    }
+
+    // ---------
+    // construct
+    // ---------
+
+    void construct (pointer p, const_reference v) {
+        new (p) T(v);
+    }
+
+    // ----------
+    // deallocate
+    // ----------
+
+    void deallocate (pointer p, size_type s) {
+        std::lock_guard<std::mutex> guard(_s->lock);
+        _s->heap.deallocate(p, s);
+    }
+
+    // -------
+    // destroy
+    // -------
+
+    void destroy (pointer p) {
+        p->~T();
+    }
+};
+
+#ifdef __linux__ // robust mutexes
+
+// -------------
+// Shm_Allocator
+// -------------
+
+/**
+ * a My_Heap in a POSIX shared memory object, behind a robust process-shared
+ * mutex, for processes that hand each other blocks without copying them
+ * every process that constructs one with the same name shares the heap;
+ * the first creates it, and the others wait for it to be ready
+ * its pointers are offset_ptrs, valid in every process if they are kept in
+ * the heap, and offset_of() and at() convert a block to an offset that can
+ * be sent to another process any other way
+ * if a process dies holding the mutex, the next to lock it checks the heap
+ * and goes on if it is intact; if it isn't, that process gets the
+ * Heap_Error, and every later lock a runtime_error
+ * the blocks of a process that dies are not freed
+ * copies share the mapping, as allocators of My_Allocator share the heap
+ */
+template <typename T, std::size_t N, typename Policy = First_Fit, std::size_t Align = 8>
+class Shm_Allocator {
+    static_assert(Align >= alignof(T), "Align must be at least alignof(T)");
+
+    template <typename, std::size_t, typename, std::size_t>
+    friend class Shm_Allocator;
+
+    // -----------
+    // operator ==
+    // -----------
+
+    template <typename U>
+    friend bool operator == (const Shm_Allocator& lhs, const Shm_Allocator<U, N, Policy, Align>& rhs) {
+        return lhs._s == rhs._s;
+    }
+
+    // -----------
+    // operator !=
+    // -----------
+
+    template <typename U>
+    friend bool operator != (const Shm_Allocator& lhs, const Shm_Allocator<U, N, Policy, Align>& rhs) {
+        return !(lhs == rhs);
+    }
+
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using heap_type       = My_Heap<N, Policy, Align>;
+
+    using value_type      = T;
+
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using pointer         = offset_ptr<value_type>;
+    using const_pointer   = offset_ptr<const value_type>;
+
+    using reference       =       value_type&;
+    using const_reference = const value_type&;
+
+    using tag_type        = typename heap_type::tag_type;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+    using is_always_equal                        = std::false_type;
+
+    template <typename U>
+    struct rebind {
+        using other = Shm_Allocator<U, N, Policy, Align>;
+    };
+
+private:
+    // ----
+    // data
+    // ----
+
+    // The shared memory object is one segment. Its creator sizes it, builds
+    // the mutex and the heap, and then stores `magic` in ready; the others
+    // wait for that before they look at anything else.
+
+    static constexpr std::uint32_t magic = 0x53484D48; // "SHMH"
+
+    struct segment {
+        std::uint32_t   ready;      // magic once the heap is built
+        std::uint32_t   recoveries; // times a process found the mutex held by a dead one
+        Heap_Image      image;      // the type of the heap, its checksum unused
+        pthread_mutex_t lock;
+        heap_type       heap;
+    };
+
+    std::shared_ptr<segment> _s;
+
+    // ------
+    // locked
+    // ------
+
+    /**
+     * holds the mutex of s, recovering it from a dead owner
+     */
+    class guard {
+        segment& _s;
+
+    public:
+        /**
+         * throw a Heap_Error exception, if the owner died and left the heap corrupt
+         * throw a runtime_error exception, if an earlier owner did
+         */
+        explicit guard (segment& s) :
+                _s (s) {
+            const int e = pthread_mutex_lock(&s.lock);
+            if (e == EOWNERDEAD) {
+                const Heap_Report r = s.heap.check_heap();
+                if (!r) {
+                    pthread_mutex_unlock(&s.lock); // without pthread_mutex_consistent, no one can lock it again
+                    throw Heap_Error(r);
+                }
+                pthread_mutex_consistent(&s.lock);
+                ++s.recoveries;
+            }
+            else if (e != 0)
+                throw std::runtime_error("Shared heap is not recoverable");
+        }
+
+        guard             (const guard&) = delete;
+        guard& operator = (const guard&) = delete;
+
+        ~guard () {
+            pthread_mutex_unlock(&_s.lock);
+        }
+    };
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * map the shared memory object name, creating it if it doesn't exist
+     * throw a runtime_error exception, if it can't be opened or mapped, or
+     * its creator doesn't build the heap within a second
+     * throw an invalid_argument exception, if it holds another type of heap
+     */
+    static std::shared_ptr<segment> attach (const char* name) {
+        constexpr std::size_t length  = sizeof(segment);
+        bool                  created = true;
+        int                   fd      = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if ((fd == -1) && (errno == EEXIST)) {
+            created = false;
+            fd      = shm_open(name, O_RDWR, 0600);
+        }
+        if (fd == -1)
+            throw std::runtime_error("Cannot open shared heap");
+        if (created && (ftruncate(fd, length) != 0)) {
+            close(fd);
+            shm_unlink(name);
+            throw std::runtime_error("Cannot open shared heap");
+        }
+        if (!created) {
+            // mapping the object before its creator has sized it would fault
+            struct stat st;
+            for (int k = 0; ; ++k) {
+                if (fstat(fd, &st) != 0) {
+                    close(fd);
+                    throw std::runtime_error("Cannot open shared heap");
+                }
+                if (st.st_size != 0)
+                    break;
+                if (k == 1000) {
+                    close(fd);
+                    throw std::runtime_error("Shared heap is not ready");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (static_cast<std::size_t>(st.st_size) != length) {
+                close(fd);
+                throw std::invalid_argument("Invalid shared heap");
+            }
+        }
+        void* m = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) {
+            if (created)
+                shm_unlink(name);
+            throw std::runtime_error("Cannot map shared heap");
+        }
+        segment* s = static_cast<segment*>(m);
+        std::atomic_ref<std::uint32_t> ready(s->ready);
+        try {
+            if (created) {
+                pthread_mutexattr_t a;
+                pthread_mutexattr_init(&a);
+                pthread_mutexattr_setpshared(&a, PTHREAD_PROCESS_SHARED);
+                pthread_mutexattr_setrobust(&a, PTHREAD_MUTEX_ROBUST);
+                pthread_mutex_init(&s->lock, &a);
+                pthread_mutexattr_destroy(&a);
+                new (&s->heap) heap_type; // this is correct and exempt from the prohibition of new
+                s->image      = heap_type::header();
+                s->recoveries = 0;
+                ready.store(magic, std::memory_order_release);
+            }
+            else {
+                for (int k = 0; ready.load(std::memory_order_acquire) != magic; ++k) {
+                    if (k == 1000)
+                        throw std::runtime_error("Shared heap is not ready");
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                if (!heap_type::matches(s->image))
+                    throw std::invalid_argument("Invalid shared heap");
+            }
+        }
+        catch (...) {
+            munmap(m, length);
+            if (created)
+                shm_unlink(name);
+            throw;
+        }
+        return std::shared_ptr<segment>(s, [] (segment* p) {munmap(p, sizeof(segment));});
+    }
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the heap in the shared memory object name, such as "/cache", created
+     * if it doesn't exist
+     */
+    explicit Shm_Allocator (const char* name) :
+            _s (attach(name))
+    {}
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * the heap of that, for another type
+     */
+    template <typename U>
+    Shm_Allocator (const Shm_Allocator<U, N, Policy, Align>& that) noexcept :
+            _s (that._s)
+    {}
+
+    Shm_Allocator             (const Shm_Allocator&) = default;
+    ~Shm_Allocator            ()                     = default;
+    Shm_Allocator& operator = (const Shm_Allocator&) = default;
+
+    // ------
+    // unlink
+    // ------
+
+    /**
+     * remove the shared memory object name, which lives on in the processes
+     * that have it mapped
+     * return false if there is none
+     */
+    static bool unlink (const char* name) {
+        return shm_unlink(name) == 0;
+    }
+
+    // --------
+    // allocate
+    // --------
+
+    pointer allocate (size_type s) {
+        guard g(*_s);
+        return pointer(_s->heap.template allocate<T>(s));
+    }
+
+    // ---------
+    // construct
+    // ---------
+
+    template <typename U, typename... Args>
+    void construct (U* p, Args&&... args) { // this is correct and exempt
+        new (p) U(std::forward<Args>(args)...); // from the prohibition of new
+    }
+
+    // ----------
+    // deallocate
+    // ----------
+
+    void deallocate (pointer p, size_type s) {
+        guard g(*_s);
+        _s->heap.deallocate(p.get(), s);
+    }
+
+    // -------
+    // destroy
+    // -------
+
+    template <typename U>
+    void destroy (U* p) { // this is correct
+        p->~U();
+    }
+
+    // -------
+    // handles
+    // -------
+
+    /**
+     * the offset of p in the heap, the same in every process
+     */
+    tag_type offset_of (const void* p) const {
+        return _s->heap.offset_of(p);
+    }
+
+    pointer at (tag_type k) const {
+        return pointer(_s->heap.template at<T>(k));
+    }
+
+    tag_type root () const {
+        guard g(*_s);
+        return _s->heap.root();
+    }
+
+    void root (tag_type k) {
+        guard g(*_s);
+        _s->heap.root(k);
+    }
+
+    // ------
+    // locked
+    // ------
+
+    /**
+     * the result of f(heap), with the mutex held, so that every process
+     * sees what f does to the heap as one operation
+     */
+    template <typename F>
+    decltype(auto) locked (F&& f) {
+        guard g(*_s);
+        return std::forward<F>(f)(_s->heap);
+    }
+
+    /**
+     * how many times a process found the mutex held by a dead one, and recovered it
+     */
+    std::uint32_t recoveries () const {
+        guard g(*_s);
+        return _s->recoveries;
+    }
+
+    // ---------------------
+    // forwarded to the heap
+    // ---------------------
+
+    Heap_Stats stats () const {
+        guard g(*_s);
+        return _s->heap.stats();
+    }
+
+    Heap_Report check_heap () const {
+        guard g(*_s);
+        return _s->heap.check_heap();
+    }
+};
+
+#endif // __linux__
+
+// --------------------
+// Concurrent_Allocator
+// --------------------
+
+/**
+ * a My_Heap shared by threads, behind a per-thread cache
+ * each thread keeps, for every request of up to Cached objects, a stack of
+ * blocks it freed or fetched ahead; those are served without locking
+ * the heap is locked only to fetch Batch blocks into an empty stack,
+ * or to return Batch blocks from a stack that reached 2 * Batch
+ * a block may be freed by any thread: it goes into that thread's cache,
+ * and from there back to the shared heap
+ * a thread's cache goes back to the heap when the thread exits, or on flush()
+ * copies share the heap; the heap lives until the last copy and the last
+ * thread cache holding it are gone
+ */
+template <typename T, std::size_t N, typename Policy = First_Fit, std::size_t Align = 8, std::size_t Cached = 16, std::size_t Batch = 16>
+class Concurrent_Allocator {
+    static_assert((Cached > 0) && (Batch > 0), "Cached and Batch must be positive");
+
+    // -----------
+    // operator ==
+    // -----------
+
+    friend bool operator == (const Concurrent_Allocator& lhs, const Concurrent_Allocator& rhs) {
+        return lhs._s == rhs._s;
+    }
+
+    // -----------
+    // operator !=
+    // -----------
+
+    friend bool operator != (const Concurrent_Allocator& lhs, const Concurrent_Allocator& rhs) {
+        return !(lhs == rhs);
+    }
+
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using heap_type       = My_Heap<N, Policy, Align>;
+
+    using value_type      = T;
+
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using pointer         =       value_type*;
+    using const_pointer   = const value_type*;
+
+    using reference       =       value_type&;
+    using const_reference = const value_type&;
+
+private:
+    // ----
+    // data
+    // ----
+
+    struct shared {
+        std::mutex lock;
+        heap_type  heap;
+    };
+
+    /**
+     * one thread's blocks of one shared heap, stack s holding blocks of s objects
+     */
+    struct cache {
+        std::shared_ptr<shared> owner;
+        std::vector<pointer>    stack[Cached + 1];
+
+        explicit cache (std::shared_ptr<shared> s) :
+                owner (std::move(s))
+        {}
+
+        cache             (const cache&) = delete;
+        cache& operator = (const cache&) = delete;
+
+        /**
+         * return the blocks to the heap, at thread exit, where an exception
+         * would terminate the process: a block the heap refuses, because
+         * the heap is corrupt, stays busy, and the others still go back
+         */
+        ~cache () {
+            std::lock_guard<std::mutex> guard(owner->lock);
+            for (size_type s = 1; s <= Cached; ++s)
+                for (pointer p : stack[s]) {
+                    try {
+                        owner->heap.deallocate(p, s);
+                    }
+                    catch (const std::logic_error&)
+                        {}
+                }
+        }
+    };
+
+    std::shared_ptr<shared> _s;
+
+    /**
+     * O(c) in time, c the number of heaps this thread has a cache for
+     * this thread's cache of _s, made on first use
+     */
+    cache& local () const {
+        thread_local std::vector<std::unique_ptr<cache>> caches;
+        thread_local cache*                              last = nullptr;
+        if ((last != nullptr) && (last->owner == _s))
+            return *last;
+        for (auto& c : caches)
+            if (c->owner == _s)
+                return *(last = c.get());
+        // drop the caches of heaps nothing else refers to any more
+        std::erase_if(caches, [] (const std::unique_ptr<cache>& c) {
+            return c->owner.use_count() == 1;
+        });
+        caches.push_back(std::make_unique<cache>(_s));
+        return *(last = caches.back().get());
+    }
+
+    /**
+     * O(Batch) heap operations, under one lock
+     * fill an empty stack with up to Batch blocks
+     * throw a std::bad_alloc exception, if not even one fits
+     */
+    void refill (cache& c, size_type s) {
+        std::lock_guard<std::mutex> guard(_s->lock);
+        try {
+            while (c.stack[s].size() != Batch)
+                c.stack[s].push_back(_s->heap.template allocate<T>(s));
+        }
+        catch (const std::bad_alloc&) {
+            if (c.stack[s].empty())
+                throw;
+        }
+    }
+
+    /**
+     * O(Batch) heap operations, under one lock
+     * return the oldest Batch blocks of a full stack to the heap
+     */
+    void spill (cache& c, size_type s) {
+        std::lock_guard<std::mutex> guard(_s->lock);
+        for (size_type i = 0; i != Batch; ++i)
+            _s->heap.deallocate(c.stack[s][i], s);
+        c.stack[s].erase(c.stack[s].begin(), c.stack[s].begin() + Batch);
+    }
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    Concurrent_Allocator () :
+            _s (std::make_shared<shared>())
+    {}
+
+    // --------
+    // allocate
+    // --------
+
+    /**
+     * O(1) in time, if this thread's stack of s is not empty
+     * requests of more than Cached objects go to the heap, under the lock
+     * a request the heap can't serve is retried once after flush()
+     * throw a std::bad_alloc exception, if there isn't an acceptable free block
+     */
+    pointer allocate (size_type s) {
+        if ((s == 0) || (s > Cached)) {
+            try {
+                std::lock_guard<std::mutex> guard(_s->lock);
+                return _s->heap.template allocate<T>(s);
+            }
+            catch (const std::bad_alloc&) {
+                flush();
+                std::lock_guard<std::mutex> guard(_s->lock);
+                return _s->heap.template allocate<T>(s);
+            }
+        }
+        cache& c = local();
+        if (c.stack[s].empty()) {
+            try {
+                refill(c, s);
+            }
+            catch (const std::bad_alloc&) {
+                flush();
+                refill(c, s);
+            }
+        }
+        const pointer p = c.stack[s].back();
+        c.stack[s].pop_back();
+        return p;
+    }
+
+    // ---------
+    // construct
+    // ---------
+
+    void construct (pointer p, const_reference v) {
+        new (p) T(v);
+    }
+
+    // ----------
+    // deallocate
+    // ----------
+
+    /**
+     * O(1) in time, unless this thread's stack of s reaches 2 * Batch
+     * s must be the size p was allocated with
+     */
+    void deallocate (pointer p, size_type s) {
+        if ((s == 0) || (s > Cached)) {
+            std::lock_guard<std::mutex> guard(_s->lock);
+            _s->heap.deallocate(p, s);
+            return;
+        }
+        cache& c = local();
+        c.stack[s].push_back(p);
+        if (c.stack[s].size() == 2 * Batch)
+            spill(c, s);
+    }
+
+    // -------
+    // destroy
+    // -------
+
+    void destroy (pointer p) {
+        p->~T();
+    }
+
+    // -----
+    // flush
+    // -----
+
+    /**
+     * return every block this thread caches to the heap, under one lock
+     */
+    void flush () {
+        cache& c = local();
+        std::lock_guard<std::mutex> guard(_s->lock);
+        for (size_type s = 1; s <= Cached; ++s) {
+            for (pointer p : c.stack[s])
+                _s->heap.deallocate(p, s);
+            c.stack[s].clear();
+        }
+    }
+};
+
+// --------------
+// Pool_Allocator
+// --------------
+
+/**
+ * Count slots of one T each, with no per-block sentinels
+ * free slots form a stack linked through their first 4 bytes; allocate and
+ * deallocate pop and push it with compare-and-swap, so they never lock
+ * the top of the stack is a slot index tagged with a count of the pushes
+ * and pops so far, so a pop that raced with a pop and a push of the same
+ * slot fails its compare-and-swap instead of corrupting the stack (ABA)
+ * a bitmap of live slots backs begin() and end(), and catches double frees
+ */
+template <typename T, std::size_t Count>
+class Pool_Allocator {
+    static_assert((Count > 0) && (Count < UINT32_MAX), "Count must fit a slot index");
+
+    // -----------
+    // operator ==
+    // -----------
+
+    friend bool operator == (const Pool_Allocator& lhs, const Pool_Allocator& rhs) {
+        return &lhs == &rhs;
+    }
+
+    // -----------
+    // operator !=
+    // -----------
+
+    friend bool operator != (const Pool_Allocator& lhs, const Pool_Allocator& rhs) {
+        return !(lhs == rhs);
+    }
+
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using value_type      = T;
+
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using pointer         =       value_type*;
+    using const_pointer   = const value_type*;
+
+    using reference       =       value_type&;
+    using const_reference = const value_type&;
+
+public:
+    // ------------------
+    // iterator
+    // over the live slots
+    // ------------------
+
+    class iterator {
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const iterator& lhs, const iterator& rhs) {
+            return (&lhs._r == &rhs._r) && (lhs._i == rhs._i);
+        }
+
+        // -----------
+        // operator !=
+        // -----------
+
+        friend bool operator != (const iterator& lhs, const iterator& rhs) {
+            return !(lhs == rhs);
+        }
+
+    public:
+        // ----
+        // data
+        // ----
+
+        Pool_Allocator& _r;
+        std::size_t     _i;
+
+    public:
+        // -----------
+        // constructor
+        // -----------
+
+        iterator (Pool_Allocator& r, size_type i) :
+            _r (r),
+            _i (r.live_from(i))
+        {}
+
+        // ----------
+        // operator *
+        // ----------
+
+        reference operator * () const {
+            return *_r.at(_i);
+        }
+
+        // -----------
+        // operator ++
+        // -----------
+
+        iterator& operator ++ () {
+            _i = _r.live_from(_i + 1);
+            return *this;
+        }
+
+        // -----------
+        // operator ++
+        // -----------
+
+        iterator operator ++ (int) {
+            iterator x = *this;
+            ++*this;
+            return x;
+        }
+    };
+
+    // ------------------
+    // const_iterator
+    // over the live slots
+    // ------------------
+
+    class const_iterator {
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const const_iterator& lhs, const const_iterator& rhs) {
+            return (&lhs._r == &rhs._r) && (lhs._i == rhs._i);
+        }
+
+        // -----------
+        // operator !=
+        // -----------
+
+        friend bool operator != (const const_iterator& lhs, const const_iterator& rhs) {
+            return !(lhs == rhs);
+        }
+
+    public:
+        // ----
+        // data
+        // ----
+
+        const Pool_Allocator& _r;
+        std::size_t           _i;
+
+    public:
+        // -----------
+        // constructor
+        // -----------
+
+        const_iterator (const Pool_Allocator& r, size_type i) :
+            _r (r),
+            _i (r.live_from(i))
+        {}
+
+        // ----------
+        // operator *
+        // ----------
+
+        const_reference operator * () const {
+            return *_r.at(_i);
+        }
+
+        // -----------
+        // operator ++
+        // -----------
+
+        const_iterator& operator ++ () {
+            _i = _r.live_from(_i + 1);
+            return *this;
+        }
+
+        // -----------
+        // operator ++
+        // -----------
+
+        const_iterator operator ++ (int) {
+            const_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+    };
+
+private:
+    // ----
+    // data
+    // ----
+
+    static constexpr std::size_t   align = std::max(alignof(T), alignof(std::uint32_t));
+    static constexpr std::size_t   slot  = (std::max(sizeof(T), sizeof(std::uint32_t)) + align - 1) / align * align;
+    static constexpr std::size_t   words = (Count + 63) / 64;
+    static constexpr std::uint32_t none  = static_cast<std::uint32_t>(Count);
+
+    alignas(align) unsigned char a[Count * slot]; // array of slots
+    std::atomic<std::uint64_t> _top;          // tag << 32 | index of the first free slot, none if empty
+    std::atomic<std::uint64_t> _live[words];  // bit i is set iff slot i is allocated
+
+    pointer at (size_type i) {
+        return reinterpret_cast<pointer>(&a[i * slot]);
+    }
+
+    const_pointer at (size_type i) const {
+        return reinterpret_cast<const_pointer>(&a[i * slot]);
+    }
+
+    /**
+     * the link of free slot i, read and written atomically: a pop may read
+     * it after another thread took the slot, and the tag then fails its
+     * compare-and-swap
+     */
+    std::atomic_ref<std::uint32_t> next (size_type i) {
+        return std::atomic_ref<std::uint32_t>(*reinterpret_cast<std::uint32_t*>(&a[i * slot]));
+    }
+
+    /**
+     * O(1) in space
+     * O(Count / 64) in time
+     * the first live slot at or after i, Count if none
+     */
+    size_type live_from (size_type i) const {
+        while (i < Count) {
+            const std::uint64_t w = _live[i / 64].load(std::memory_order_acquire) >> (i % 64);
+            if (w != 0)
+                return std::min<size_type>(i + std::countr_zero(w), Count);
+            i = (i / 64 + 1) * 64;
+        }
+        return Count;
+    }
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(Count) in time
+     */
+    Pool_Allocator () :
+            _top (none) {
+        for (size_type i = 0; i != Count; ++i)
+            next(i).store(static_cast<std::uint32_t>(i + 1), std::memory_order_relaxed);
+        _top.store(0, std::memory_order_release);
+        for (auto& w : _live)
+            w.store(0, std::memory_order_relaxed);
+    }
+
+    Pool_Allocator             (const Pool_Allocator&) = delete;
+    Pool_Allocator& operator = (const Pool_Allocator&) = delete;
+
+    // --------
+    // allocate
+    // --------
+
+    /**
+     * O(1) in space
+     * O(1) in time, retried while other threads win the compare-and-swap
+     * throw a std::bad_alloc exception, if s isn't 1 or every slot is taken
+     */
+    pointer allocate (size_type s) {
+        if (s != 1)
+            throw std::bad_alloc();
+        std::uint64_t top = _top.load(std::memory_order_acquire);
+        std::uint32_t i;
+        do {
+            i = static_cast<std::uint32_t>(top);
+            if (i == none)
+                throw std::bad_alloc();
+            const std::uint64_t tag = (top >> 32) + 1;
+            if (_top.compare_exchange_weak(top, (tag << 32) | next(i).load(std::memory_order_relaxed),
+                                           std::memory_order_acquire, std::memory_order_acquire))
+                break;
+        } while (true);
+        _live[i / 64].fetch_or(std::uint64_t(1) << (i % 64), std::memory_order_release);
+        return at(i);
+    }
+
+    // ---------
+    // construct
+    // ---------
+
+    void construct (pointer p, const_reference v) {
+        new (p) T(v);
+    }
+
+    // ----------
+    // deallocate
+    // ----------
+
+    /**
+     * O(1) in space
+     * O(1) in time, retried while other threads win the compare-and-swap
+     * throw an invalid_argument exception, if p is not a live slot
+     */
+    void deallocate (pointer p, size_type) {
+        const std::ptrdiff_t d = reinterpret_cast<unsigned char*>(p) - a;
+        if ((d < 0) || (d >= static_cast<std::ptrdiff_t>(Count * slot)) || (d % slot != 0))
+            throw std::invalid_argument("Invalid pointer");
+        const std::uint32_t i   = static_cast<std::uint32_t>(d / slot);
+        const std::uint64_t bit = std::uint64_t(1) << (i % 64);
+        if ((_live[i / 64].fetch_and(~bit, std::memory_order_acq_rel) & bit) == 0)
+            throw std::invalid_argument("Block is already free");
+        std::uint64_t top = _top.load(std::memory_order_relaxed);
+        do {
+            next(i).store(static_cast<std::uint32_t>(top), std::memory_order_relaxed);
+        } while (!_top.compare_exchange_weak(top, (((top >> 32) + 1) << 32) | i,
+                                             std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // -------
+    // destroy
+    // -------
+
+    void destroy (pointer p) {
+        p->~T();
+    }
+
+    // -----
+    // begin
+    // -----
+
+    /**
+     * the iterators see a snapshot of the live slots
+     * a slot allocated or freed meanwhile may or may not be visited
+     */
+    iterator begin () {
+        return iterator(*this, 0);
+    }
+
+    const_iterator begin () const {
+        return const_iterator(*this, 0);
+    }
+
+    // ---
+    // end
+    // ---
+
+    iterator end () {
+        return iterator(*this, Count);
+    }
+
+    const_iterator end () const {
+        return const_iterator(*this, Count);
+    }
+};
+
+// ------------------
+// Growable_Allocator
+// ------------------
+
+/**
+ * a heap that grows by Chunk bytes at a time, instead of a fixed char a[N]
+ * every chunk is a My_Heap of its own in a region mapped with mmap on
+ * demand, at a multiple of Chunk, so the chunk of a pointer is found by
+ * masking it
+ * the first and last sentinels of a chunk are its fences: deallocate never
+ * looks before the first block or after the last one of a chunk, so blocks
+ * of different chunks are never coalesced
+ * when a chunk becomes entirely free, its payload pages are given back to
+ * the OS with madvise(MADV_DONTNEED); the mapping stays for the next request
+ * requests larger than a chunk throw std::bad_alloc
+ * copies share the chunks, which are unmapped with the last copy
+ */
+template <typename T, std::size_t Chunk = (1 << 20), typename Policy = First_Fit, std::size_t Align = 8>
+class Growable_Allocator {
+    static_assert(std::has_single_bit(Chunk) && (Chunk >= 8192), "Chunk must be a power of two of at least 8 KiB");
+
+    // -----------
+    // operator ==
+    // -----------
+
+    friend bool operator == (const Growable_Allocator& lhs, const Growable_Allocator& rhs) {
+        return lhs._s == rhs._s;
+    }
+
+    // -----------
+    // operator !=
+    // -----------
+
+    friend bool operator != (const Growable_Allocator& lhs, const Growable_Allocator& rhs) {
+        return !(lhs == rhs);
+    }
+
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using heap_type       = My_Heap<Chunk - 1024, Policy, Align>;
+
+    using value_type      = T;
+
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using pointer         =       value_type*;
+    using const_pointer   = const value_type*;
+
+    using reference       =       value_type&;
+    using const_reference = const value_type&;
+
+    static_assert(Align >= alignof(T), "Align must be at least alignof(T)");
+
+private:
+    // ----
+    // data
+    // ----
+
+    struct chunk {
+        chunk*    next;
+        bool      released; // its free pages were given back
+        heap_type heap;
+
+        explicit chunk (chunk* n) :
+                next     (n),
+                released (false)
+        {}
+    };
+
+    static_assert(sizeof(chunk) <= Chunk, "a chunk must fit its mapping");
+
+    struct shared {
+        chunk*    head  = nullptr;
+        chunk*    last  = nullptr; // the chunk that served the previous request
+        size_type count = 0;
+
+        shared             ()              = default;
+        shared             (const shared&) = delete;
+        shared& operator = (const shared&) = delete;
+
+        ~shared () {
+            while (head != nullptr) {
+                chunk* c = head;
+                head = c->next;
+                c->~chunk();
+                munmap(c, Chunk);
+            }
+        }
+    };
+
+    std::shared_ptr<shared> _s;
+
+    /**
+     * map Chunk bytes at a multiple of Chunk, by mapping twice as much and
+     * unmapping either side
+     * throw a std::bad_alloc exception, if the OS refuses
+     */
+    chunk* grow () {
+        void* m = mmap(nullptr, 2 * Chunk, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED)
+            throw std::bad_alloc();
+        const std::uintptr_t b = reinterpret_cast<std::uintptr_t>(m);
+        const std::uintptr_t c = (b + Chunk - 1) & ~std::uintptr_t(Chunk - 1);
+        if (c != b)
+            munmap(m, c - b);
+        if (c + Chunk != b + 2 * Chunk)
+            munmap(reinterpret_cast<void*>(c + Chunk), b + Chunk - c);
+        chunk* p = new (reinterpret_cast<void*>(c)) chunk(_s->head);
+        _s->head = p;
+        ++_s->count;
+        return p;
+    }
+
+    /**
+     * O(c) in time, c the number of chunks
+     * the chunk p points into, nullptr if none
+     */
+    chunk* chunk_of (const void* p) const {
+        const std::uintptr_t c = reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t(Chunk - 1);
+        for (chunk* q = _s->head; q != nullptr; q = q->next)
+            if (reinterpret_cast<std::uintptr_t>(q) == c)
+                return q;
+        return nullptr;
+    }
+
+    /**
+     * O(c) in time, c the number of chunks
+     * the chunk p was allocated from
+     * throw an invalid_argument exception, if there is none
+     */
+    chunk* owner (const void* p) const {
+        chunk* c = chunk_of(p);
+        if (c == nullptr)
+            throw std::invalid_argument("Invalid pointer");
+        return c;
+    }
+
+    /**
+     * O(1) in time
+     * true iff s objects fit in an empty chunk; a request that doesn't is
+     * refused before a chunk is mapped for it
+     */
+    static bool fits (size_type s) {
+        if (s > std::numeric_limits<size_type>::max() / sizeof(T))
+            return false;
+        const auto b = heap_type::block_of(s * sizeof(T));
+        return (b != -1) && (b <= heap_type::largest());
+    }
+
+    /**
+     * give the pages of the one free block of c back to the OS, keeping
+     * the pages of its sentinels and of its free-list links
+     */
+    static void release (chunk* c) {
+        constexpr std::size_t word = sizeof(typename heap_type::tag_type);
+        const long           page = sysconf(_SC_PAGESIZE);
+        const std::uintptr_t b    = reinterpret_cast<std::uintptr_t>(&c->heap[0]) + 3 * word;
+        const std::uintptr_t e    = reinterpret_cast<std::uintptr_t>(&c->heap[c->heap.end()._i - word]);
+        const std::uintptr_t lo   = (b + page - 1) & ~std::uintptr_t(page - 1);
+        const std::uintptr_t hi   = e & ~std::uintptr_t(page - 1);
+        if (hi > lo)
+            madvise(reinterpret_cast<void*>(lo), hi - lo, MADV_DONTNEED);
+        c->released = true;
+    }
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    /**
+     * O(1) in space
+     * O(1) in time
+     * no chunk is mapped until the first request
+     */
+    Growable_Allocator () :
+            _s (std::make_shared<shared>())
+    {}
+
+    // --------
+    // allocate
+    // --------
+
+    /**
+     * O(c) in time, c the number of chunks, if the previous chunk is full
+     * the chunk that served the previous request is tried first, then every
+     * chunk, then a new one
+     * throw a std::bad_alloc exception, if s objects don't fit in a chunk,
+     * or if the OS refuses a new one
+     */
+    pointer allocate (size_type s) {
+        if (!fits(s))
+            throw std::bad_alloc();
+        const size_type n = s * sizeof(T);
+        char*           p = nullptr;
+        chunk*          c = _s->last;
+        if (c != nullptr)
+            p = c->heap.try_allocate(n);
+        for (chunk* q = _s->head; (p == nullptr) && (q != nullptr); q = q->next)
+            if (q != _s->last)
+                p = (c = q)->heap.try_allocate(n);
+        if (p == nullptr)
+            p = (c = grow())->heap.try_allocate(n);
+        if (p == nullptr)
+            throw std::bad_alloc();
+        c->released = false;
+        _s->last    = c;
+        return reinterpret_cast<pointer>(p);
+    }
+
+    // ---------
+    // construct
+    // ---------
+
+    void construct (pointer p, const_reference v) {
+        new (p) T(v);
+    }
+
+    // ----------
+    // deallocate
+    // ----------
+
+    /**
+     * O(c) in time, c the number of chunks
+     * throw an invalid_argument exception, if p is invalid
+     */
+    void deallocate (pointer p, size_type s) {
+        chunk* c = owner(p);
+        c->heap.deallocate(reinterpret_cast<char*>(p), s * sizeof(T));
+        if (c->heap.empty())
+            release(c);
+    }
+
+    // ----------
+    // reallocate
+    // ----------
+
+    /**
+     * O(c) in time, c the number of chunks
+     * resize the block at p from old_n to new_n objects, within its chunk
+     * when that fits, otherwise in another chunk, to which the first
+     * min(old_n, new_n) objects are moved
+     * throw a std::bad_alloc exception, if new_n objects don't fit in a chunk,
+     * or if the OS refuses a new one, leaving the block at p as it was
+     * throw an invalid_argument exception, if p is invalid
+     */
+    pointer reallocate (pointer p, size_type old_n, size_type new_n) {
+        chunk* c = owner(p);
+        if (!fits(new_n))
+            throw std::bad_alloc();
+        try {
+            return c->heap.reallocate(p, old_n, new_n);
+        }
+        catch (const std::bad_alloc&)
+            {}
+        const pointer   q = allocate(new_n);
+        const size_type n = std::min(old_n, new_n);
+        size_type k = 0;
+        try {
+            for (; k != n; ++k)
+                new (q + k) T(std::move_if_noexcept(p[k]));
+        }
+        catch (...) {
+            while (k != 0)
+                q[--k].~T();
+            deallocate(q, new_n);
+            throw;
+        }
+        for (k = 0; k != n; ++k)
+            p[k].~T();
+        deallocate(p, old_n);
+        return q;
+    }
+
+    // -------
+    // destroy
+    // -------
+
+    void destroy (pointer p) {
+        p->~T();
+    }
+
+    // ----
+    // owns
+    // ----
+
+    /**
+     * O(c) in time, c the number of chunks
+     * true iff p points into one of the chunks
+     */
+    bool owns (const void* p) const {
+        return chunk_of(p) != nullptr;
+    }
+
+    // --------
+    // capacity
+    // --------
+
+    /**
+     * O(c) in time, c the number of chunks
+     * the number of objects the block at p can hold
+     * throw an invalid_argument exception, if p is invalid
+     */
+    size_type capacity (const_pointer p) const {
+        return owner(p)->heap.capacity(reinterpret_cast<const char*>(p)) / sizeof(T);
+    }
+
+    // ------
+    // chunks
+    // ------
+
+    /**
+     * the number of chunks mapped, and of those given back to the OS
+     */
+    size_type chunks () const {
+        return _s->count;
+    }
+
+    size_type released () const {
+        size_type n = 0;
+        for (chunk* q = _s->head; q != nullptr; q = q->next)
+            n += q->released;
+        return n;
+    }
+};
+
+// ------------
+// Trace_Record
+// ------------
+
+/**
+ * one request in a binary trace
+ * a trace is a Trace_Header followed by Trace_Records, in the byte order of
+ * the machine that recorded it, so a trace can be memory-mapped as is
+ */
+struct Trace_Record {
+    enum Op : std::uint8_t {allocate = 'a', deallocate = 'd', reallocate = 'r'};
+
+    std::uint64_t time;         // nanoseconds since the recording started
+    std::uint64_t id;           // object, numbered from 1 in order of allocation
+    std::uint32_t bytes;        // size of the block allocated, freed, or resized to
+    std::uint16_t thread;       // numbered from 0 in order of first request
+    Op            op;
+    std::uint8_t  reserved = 0;
+};
+
+static_assert(sizeof(Trace_Record) == 24, "a Trace_Record must have no padding");
+
+struct Trace_Header {
+    char          magic[8] = {'A', 'L', 'L', 'O', 'C', 'T', 'R', 'C'};
+    std::uint32_t version  = 1;
+    std::uint32_t record   = sizeof(Trace_Record);
+};
+
+// ------------
+// Trace_Writer
+// ------------
+
+/**
+ * appends Trace_Records to a file, from any number of threads and allocators
+ * records are buffered and written 4096 at a time, and when the writer is
+ * flushed or destroyed
+ */
+class Trace_Writer {
+    std::FILE*                            _file;
+    std::mutex                            _lock;
+    std::vector<Trace_Record>             _buffer;
+    std::vector<std::thread::id>          _threads;
+    std::chrono::steady_clock::time_point _start;
+    std::uint64_t                         _ids;
+
+    void write_buffer () {
+        if (std::fwrite(_buffer.data(), sizeof(Trace_Record), _buffer.size(), _file) != _buffer.size())
+            throw std::runtime_error("Cannot write trace");
+        _buffer.clear();
+    }
+
+    /**
+     * throw a length_error exception, if the calling thread is new and
+     * there are already as many threads as a Trace_Record can number
+     */
+    std::uint16_t thread () {
+        const std::thread::id t = std::this_thread::get_id();
+        const auto            i = std::find(_threads.begin(), _threads.end(), t);
+        if (i != _threads.end())
+            return static_cast<std::uint16_t>(i - _threads.begin());
+        if (_threads.size() > std::numeric_limits<std::uint16_t>::max())
+            throw std::length_error("Too many threads to trace");
+        _threads.push_back(t);
+        return static_cast<std::uint16_t>(_threads.size() - 1);
+    }
+
+public:
+    /**
+     * throw a runtime_error exception, if path can't be written
+     */
+    explicit Trace_Writer (const char* path) :
+            _file  (std::fopen(path, "wb")),
+            _start (std::chrono::steady_clock::now()),
+            _ids   (0) {
+        const Trace_Header h;
+        if ((_file == nullptr) || (std::fwrite(&h, sizeof(h), 1, _file) != 1)) {
+            if (_file != nullptr)
+                std::fclose(_file);
+            throw std::runtime_error("Cannot write trace");
+        }
+        _buffer.reserve(4096);
+    }
+
+    Trace_Writer             (const Trace_Writer&) = delete;
+    Trace_Writer& operator = (const Trace_Writer&) = delete;
+
+    ~Trace_Writer () {
+        try {
+            flush();
+        }
+        catch (const std::runtime_error&)
+            {}
+        std::fclose(_file);
+    }
+
+    /**
+     * number the calling thread, if it is new, so that a write of bytes
+     * from it will fit a Trace_Record
+     * throw a length_error exception, if bytes doesn't fit a uint32_t, or
+     * the thread can't be numbered
+     */
+    void check (std::size_t bytes) {
+        if (bytes > std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("Too many bytes to trace");
+        std::lock_guard<std::mutex> guard(_lock);
+        thread();
+    }
+
+    /**
+     * record op on object id, a new object if id is 0
+     * return the id
+     * throw a length_error exception, as check does, recording nothing
+     */
+    std::uint64_t write (Trace_Record::Op op, std::uint64_t id, std::size_t bytes) {
+        if (bytes > std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("Too many bytes to trace");
+        const auto t = std::chrono::steady_clock::now() - _start;
+        std::lock_guard<std::mutex> guard(_lock);
+        const std::uint16_t n = thread();
+        if (id == 0)
+            id = ++_ids;
+        _buffer.push_back({static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t).count()),
+                           id, static_cast<std::uint32_t>(bytes), n, op});
+        if (_buffer.size() == 4096)
+            write_buffer();
+        return id;
+    }
+
+    void flush () {
+        std::lock_guard<std::mutex> guard(_lock);
+        write_buffer();
+        std::fflush(_file);
+    }
+};
+
+// -------------------
+// Recording_Allocator
+// -------------------
+
+/**
+ * the allocator A, recording every allocate, deallocate, and reallocate
+ * that succeeds to a Trace_Writer, with sizes in bytes
+ * safe to share between threads iff A is
+ */
+template <typename A>
+class Recording_Allocator {
+public:
+    // --------
+    // typedefs
+    // --------
+
+    using heap_type       = A;
+
+    using value_type      = typename A::value_type;
+
+    using size_type       = typename A::size_type;
+    using difference_type = typename A::difference_type;
+
+    using pointer         = typename A::pointer;
+    using const_pointer   = typename A::const_pointer;
+
+    using reference       = typename A::reference;
+    using const_reference = typename A::const_reference;
+
+private:
+    // ----
+    // data
+    // ----
+
+    A                                                                 _heap;
+    Trace_Writer*                                                     _trace;
+    std::mutex                                                        _lock;
+    std::unordered_map<const_pointer, std::pair<std::uint64_t, size_type>> _ids; // id and bytes of each live block
+
+    /**
+     * remove the id and bytes of the block at p, before the heap can hand
+     * p to another thread, which would record its own id under p
+     * return {0, 0}, if p isn't recorded
+     */
+    std::pair<std::uint64_t, size_type> take (const_pointer p) {
+        std::lock_guard<std::mutex> guard(_lock);
+        const auto i = _ids.find(p);
+        if (i == _ids.end())
+            return {0, 0};
+        const auto e = i->second;
+        _ids.erase(i);
+        return e;
+    }
+
+    /**
+     * give the block at p back what take removed, when the heap refused p
+     */
+    void put (const_pointer p, const std::pair<std::uint64_t, size_type>& e) {
+        if (e.first == 0)
+            return;
+        std::lock_guard<std::mutex> guard(_lock);
+        _ids[p] = e;
+    }
+
+public:
+    // -----------
+    // constructor
+    // -----------
+
+    explicit Recording_Allocator (Trace_Writer& trace) :
+            _trace (&trace)
+        {}
+
+    Recording_Allocator             (const Recording_Allocator&) = delete;
+    Recording_Allocator& operator = (const Recording_Allocator&) = delete;
+
+    // --------
+    // allocate
+    // --------
+
+    /**
+     * throw a length_error exception, as Trace_Writer::check does, before
+     * allocating
+     */
+    pointer allocate (size_type s) {
+        const size_type bytes = s * sizeof(value_type);
+        _trace->check(bytes);
+        const pointer   p     = _heap.allocate(s);
+        std::lock_guard<std::mutex> guard(_lock);
+        _ids[p] = {_trace->write(Trace_Record::allocate, 0, bytes), bytes};
+        return p;
+    }
+
+    // ---------
+    // construct
+    // ---------
+
+    void construct (pointer p, const_reference v) {
+        _heap.construct(p, v);
+    }
+
+    // ----------
+    // deallocate
+    // ----------
+
+    /**
+     * throw an invalid_argument exception, if p is invalid
+     * throw a length_error exception, as Trace_Writer::check does, before
+     * deallocating
+     */
+    void deallocate (pointer p, size_type s) {
+        _trace->check(0);
+        const auto e = take(p);
+        try {
+            _heap.deallocate(p, s);
+        }
+        catch (...) {
+            put(p, e);
+            throw;
+        }
+        if (e.first != 0)
+            _trace->write(Trace_Record::deallocate, e.first, e.second);
+    }
+
+    // ----------
+    // reallocate
+    // ----------
+
+    /**
+     * throw a length_error exception, as Trace_Writer::check does, before
+     * reallocating
+     */
+    pointer reallocate (pointer p, size_type old_n, size_type new_n) {
+        const size_type bytes = new_n * sizeof(value_type);
+        _trace->check(bytes);
+        const auto e = take(p);
+        pointer    q;
+        try {
+            q = _heap.reallocate(p, old_n, new_n);
+        }
+        catch (...) {
+            put(p, e);
+            throw;
+        }
+        if (e.first != 0)
+            put(q, {_trace->write(Trace_Record::reallocate, e.first, bytes), bytes});
+        return q;
+    }
+
+    // -------
+    // destroy
+    // -------
+
+    void destroy (pointer p) {
+        _heap.destroy(p);
+    }
+
+    // ----
+    // heap
+    // ----
+
+    /**
+     * the allocator being recorded
+     */
+    A& heap () {
+        return _heap;
+    }
+
+    const A& heap () const {
+        return _heap;
+    }
+};
+
+// ------------
+// Trace_Reader
+// ------------
+
+/**
+ * reads the Trace_Records of a trace in order, mapping window bytes of the
+ * file at a time, so that traces much larger than memory can be streamed
+ */
+class Trace_Reader {
+    static constexpr std::uint64_t window = std::uint64_t(1) << 26;
+
+    int           _fd;
+    std::uint64_t _size;
+    std::uint64_t _pos;           // offset of the next record
+    const char*   _map    = nullptr;
+    std::uint64_t _start  = 0;    // offset of the mapped window
+    std::uint64_t _length = 0;
+
+public:
+    /**
+     * throw a runtime_error exception, if path can't be read
+     * throw an invalid_argument exception, if it isn't a trace this reader knows
+     */
+    explicit Trace_Reader (const char* path) :
+            _fd   (open(path, O_RDONLY)),
+            _size (0),
+            _pos  (sizeof(Trace_Header)) {
+        struct stat st;
+        if ((_fd == -1) || (fstat(_fd, &st) != 0)) {
+            if (_fd != -1)
+                close(_fd);
+            throw std::runtime_error("Cannot read trace");
+        }
+        _size = st.st_size;
+        Trace_Header       h;
+        const Trace_Header expected;
+        if ((_size < sizeof(h)) || (pread(_fd, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h))) ||
+                (std::memcmp(&h, &expected, sizeof(h)) != 0)) {
+            close(_fd);
+            throw std::invalid_argument("Invalid trace");
+        }
+    }
+
+    Trace_Reader             (const Trace_Reader&) = delete;
+    Trace_Reader& operator = (const Trace_Reader&) = delete;
+
+    ~Trace_Reader () {
+        if (_map != nullptr)
+            munmap(const_cast<char*>(_map), _length);
+        close(_fd);
+    }
+
+    /**
+     * O(1) in space
+     * O(1) in time, amortized
+     * read the next record into r
+     * return false at the end of the trace, ignoring a partial last record
+     * throw a runtime_error exception, if the file can't be mapped
+     */
+    bool next (Trace_Record& r) {
+        if (_pos + sizeof(r) > _size)
+            return false;
+        if ((_map == nullptr) || (_pos + sizeof(r) > _start + _length)) {
+            if (_map != nullptr)
+                munmap(const_cast<char*>(_map), _length);
+            const std::uint64_t page = sysconf(_SC_PAGESIZE);
+            _start  = _pos / page * page;
+            _length = std::min(window, _size - _start);
+            void* m = mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, _fd, _start);
+            if (m == MAP_FAILED) {
+                _map = nullptr;
+                throw std::runtime_error("Cannot map trace");
+            }
+            madvise(m, _length, MADV_SEQUENTIAL);
+            _map = static_cast<const char*>(m);
+        }
+        std::memcpy(&r, _map + (_pos - _start), sizeof(r));
+        _pos += sizeof(r);
+        return true;
+    }
+};
 
 #endif // Allocator_hpp
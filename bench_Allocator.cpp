@@ -0,0 +1,752 @@
+// ------------------
+// BenchAllocator.cpp
+// ------------------
+
+// https://github.com/google/benchmark
+// https://github.com/google/benchmark/blob/main/docs/user_guide.md
+
+// --------
+// includes
+// --------
+
+#include <algorithm> // max, min, nth_element
+#include <atomic>    // atomic
+#include <chrono>    // steady_clock
+#include <cmath>     // pow
+#include <cstddef>   // size_t
+#include <cstdint>   // uintptr_t, UINTPTR_MAX
+#include <cstdlib>   // _Exit, free, malloc
+#include <cstring>   // strncmp
+#include <fstream>   // ifstream
+#include <iostream>  // cerr
+#include <malloc.h>  // malloc_usable_size
+#include <memory>    // allocator, make_shared, make_unique, shared_ptr, unique_ptr
+#include <new>       // bad_alloc
+#include <random>    // mt19937, uniform_int_distribution, uniform_real_distribution
+#include <string>    // getline, stoi, string, to_string
+#include <thread>    // thread, yield
+#include <type_traits> // is_same_v
+#include <utility>   // make_pair, pair
+#include <vector>    // vector
+
+#include <sys/wait.h> // waitpid
+#include <unistd.h>   // fork, getpid
+
+#include "benchmark/benchmark.h"
+
+#include "Allocator.hpp"
+
+using namespace std;
+
+namespace {
+
+constexpr std::size_t heap_size = 1 << 20;
+constexpr std::size_t tail_size = 4096;
+constexpr std::size_t request   = 64;    // 512 bytes, larger than any hole
+
+using allocator_type = My_Allocator<double, heap_size>;
+
+/**
+ * allocator_type, holding freed blocks of up to 16 objects and coalescing
+ * them 64 at a time
+ */
+struct Deferred_Allocator : allocator_type {
+    Deferred_Allocator () {
+        deferral({128, 64});
+    }
+};
+
+/**
+ * allocator_type, hardened: canaries, poisoning, and a quarantine of 16 blocks
+ */
+using hardened_type = My_Allocator<double, heap_size, Hardened<First_Fit>>;
+
+// ---------
+// fragments
+// ---------
+
+/**
+ * fill the heap with one-object blocks, leaving a free tail, then free
+ * blocks so that busy / total is the given percentage
+ * every hole is smaller than request, so only the tail fits it
+ */
+unique_ptr<allocator_type> fragments (int occupancy) {
+    auto x = make_unique<allocator_type>();
+    const std::size_t blocks = (heap_size - tail_size) / 16;
+    allocator_type::pointer* p = new allocator_type::pointer[blocks];
+    for (std::size_t i = 0; i != blocks; ++i)
+        p[i] = x->allocate(1);
+    for (std::size_t i = 0; i != blocks; ++i)
+        if (static_cast<int>((i * occupancy) % 100) >= occupancy)
+            x->deallocate(p[i], 1);
+    delete [] p;
+    return x;
+}
+
+// ----
+// scan
+// ----
+
+/**
+ * the search allocate used to do, walking every block from begin()
+ * the old allocate paid at least this much before it could split
+ */
+void BM_Scan (benchmark::State& state) {
+    auto       x    = fragments(static_cast<int>(state.range(0)));
+    const int  size = request * 8;
+    for (auto _ : state) {
+        auto it = x->begin();
+        while ((it != x->end()) && (*it < size))
+            ++it;
+        benchmark::DoNotOptimize(it._i);
+    }
+}
+
+// ---------
+// free list
+// ---------
+
+/**
+ * allocate and deallocate the same request, searching the free list only
+ */
+void BM_Free_List (benchmark::State& state) {
+    auto x = fragments(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        allocator_type::pointer p = x->allocate(request);
+        benchmark::DoNotOptimize(p);
+        x->deallocate(p, request);
+    }
+}
+
+// -----
+// small
+// -----
+
+/**
+ * allocate and deallocate one object, served from the 8-byte bin
+ */
+void BM_Small (benchmark::State& state) {
+    auto x = fragments(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        allocator_type::pointer p = x->allocate(1);
+        benchmark::DoNotOptimize(p);
+        x->deallocate(p, 1);
+    }
+}
+
+// -------
+// threads
+// -------
+
+/**
+ * every thread allocates and deallocates a burst of small requests on one
+ * shared allocator
+ */
+template <typename A>
+void BM_Threads (benchmark::State& state) {
+    static A x;
+    typename A::pointer p[8];
+    for (auto _ : state) {
+        for (int i = 0; i != 8; ++i)
+            p[i] = x.allocate(1 + i % 4);
+        for (int i = 0; i != 8; ++i)
+            x.deallocate(p[i], 1 + i % 4);
+    }
+    state.SetItemsProcessed(state.iterations() * 16);
+}
+
+// ------
+// single
+// ------
+
+/**
+ * every thread allocates and deallocates a burst of single objects on one
+ * shared allocator
+ */
+template <typename A>
+void BM_Single (benchmark::State& state) {
+    static A x;
+    typename A::pointer p[8];
+    for (auto _ : state) {
+        for (int i = 0; i != 8; ++i)
+            p[i] = x.allocate(1);
+        for (int i = 0; i != 8; ++i)
+            x.deallocate(p[i], 1);
+    }
+    state.SetItemsProcessed(state.iterations() * 16);
+}
+
+// ----------------
+// Malloc_Allocator
+// ----------------
+
+/**
+ * glibc malloc and free behind the allocate and deallocate of the other allocators
+ */
+struct Malloc_Allocator {
+    using value_type = double;
+
+    double* allocate (std::size_t s) {
+        void* p = std::malloc(s * sizeof(double));
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return static_cast<double*>(p);
+    }
+
+    void deallocate (double* p, std::size_t) {
+        std::free(p);
+    }
+};
+
+// --------
+// workload
+// --------
+
+/**
+ * allocate size objects into slot, or deallocate the block in slot if size is 0
+ * every workload ends with all of its blocks deallocated, so it can be
+ * replayed on the same allocator over and over
+ */
+struct Request {
+    int slot;
+    int size;
+};
+
+using Workload = vector<Request>;
+
+constexpr int requests = 1 << 14; // in each synthetic workload, about
+constexpr int slots    = 256;     // most blocks live at once, in random workloads
+
+/**
+ * bursts of up to 64 blocks, deallocated in the reverse order
+ */
+Workload lifo () {
+    std::mt19937                       g(371);
+    std::uniform_int_distribution<int> depth(1, 64);
+    std::uniform_int_distribution<int> size(1, 16);
+    Workload w;
+    while (static_cast<int>(w.size()) < requests) {
+        const int d = depth(g);
+        for (int i = 0; i != d; ++i)
+            w.push_back({i, size(g)});
+        for (int i = d; i != 0; --i)
+            w.push_back({i - 1, 0});
+    }
+    return w;
+}
+
+/**
+ * a window of blocks in which the oldest is deallocated to make room for the newest
+ */
+Workload fifo () {
+    std::mt19937                       g(371);
+    std::uniform_int_distribution<int> size(1, 16);
+    Workload w;
+    int i = 0;
+    for (; i != requests / 2; ++i) {
+        if (i >= slots)
+            w.push_back({i % slots, 0});
+        w.push_back({i % slots, size(g)});
+    }
+    for (int j = std::max(i - slots, 0); j != i; ++j)
+        w.push_back({j % slots, 0});
+    return w;
+}
+
+/**
+ * each request picks a random slot and deallocates its block, or allocates
+ * one of size(g) objects if it is empty, so that lifetimes are random
+ */
+template <typename Size>
+Workload random_lifetimes (Size size) {
+    std::mt19937                       g(371);
+    std::uniform_int_distribution<int> slot(0, slots - 1);
+    vector<bool> live(slots, false);
+    Workload w;
+    for (int i = 0; i != requests; ++i) {
+        const int k = slot(g);
+        w.push_back({k, live[k] ? 0 : size(g)});
+        live[k] = !live[k];
+    }
+    for (int k = 0; k != slots; ++k)
+        if (live[k])
+            w.push_back({k, 0});
+    return w;
+}
+
+/**
+ * random lifetimes with sizes from 1 to 16 objects
+ */
+Workload uniform () {
+    std::uniform_int_distribution<int> size(1, 16);
+    return random_lifetimes([&] (std::mt19937& g) {return size(g);});
+}
+
+/**
+ * random lifetimes with Pareto sizes, mostly one object, up to 64
+ */
+Workload power_law () {
+    std::uniform_real_distribution<double> u(0, 1);
+    return random_lifetimes([&] (std::mt19937& g) {
+        return std::min(static_cast<int>(std::pow(1 - u(g), -1 / 1.2)), 64);});
+}
+
+// -----
+// trace
+// -----
+
+/**
+ * the test cases of a run_Allocator input file, as one workload
+ * a deallocation names the k-th busy block in address order, so requests
+ * are resolved against the My_Allocator<double, 1000> that run_Allocator
+ * replays them on, and failed requests are dropped
+ */
+Workload trace (std::istream& in) {
+    using heap_type = My_Allocator<double, 1000>;
+    Workload w;
+    std::string line;
+    std::getline(in, line);
+    std::getline(in, line);
+    bool more = true;
+    while (more) {
+        heap_type                                  x;
+        vector<pair<heap_type::pointer, int>>      busy; // sorted by pointer
+        vector<int>                                spare;
+        int                                        next = 0;
+        more = false;
+        while (std::getline(in, line) && !line.empty()) {
+            more = true;
+            const int r = std::stoi(line);
+            if (r > 0) {
+                const heap_type::pointer p = x.try_allocate(r);
+                if (p == nullptr)
+                    continue;
+                int k = next;
+                if (spare.empty())
+                    ++next;
+                else {
+                    k = spare.back();
+                    spare.pop_back();
+                }
+                busy.insert(std::lower_bound(busy.begin(), busy.end(), make_pair(p, k)), make_pair(p, k));
+                w.push_back({k, r});
+            }
+            else if (-r <= static_cast<int>(busy.size())) {
+                const auto b = busy.begin() + (-r - 1);
+                x.deallocate(b->first, 0);
+                w.push_back({b->second, 0});
+                spare.push_back(b->second);
+                busy.erase(b);
+            }
+        }
+        for (const auto& b : busy)
+            w.push_back({b.second, 0});
+    }
+    return w;
+}
+
+// ------
+// meters
+// ------
+
+/**
+ * the q-quantile of v, reordering v
+ */
+double percentile (vector<long>& v, double q) {
+    if (v.empty())
+        return 0;
+    const auto it = v.begin() + static_cast<long>(q * (v.size() - 1));
+    std::nth_element(v.begin(), it, v.end());
+    return *it;
+}
+
+/**
+ * latency of every request in one of every eight iterations, and the peak
+ * heap: the span of addresses the blocks covered, or for allocators on
+ * glibc malloc, which spreads blocks over its arenas, the most bytes it
+ * held at once for the live blocks, headers included
+ * for allocators with stats(), also the mean fragmentation after every
+ * request of those iterations: the share of the bytes not in use, free or
+ * held, that are outside the largest free block
+ */
+struct Meter {
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t most = 1 << 20; // latencies kept
+
+    vector<long>   latency;
+    std::uintptr_t low  = UINTPTR_MAX;
+    std::uintptr_t high = 0;
+    long           runs = 0;
+    bool           by_malloc;
+    std::size_t    live = 0;
+    std::size_t    peak = 0;
+    double         frag = 0; // sum over the requests measured
+    long           made = 0; // requests measured for fragmentation
+
+    explicit Meter (bool m) :
+            by_malloc (m) {
+        latency.reserve(most);
+    }
+
+    static std::size_t held (const double* p) {
+#ifdef __GLIBC__
+        return malloc_usable_size(const_cast<double*>(p)) + sizeof(std::size_t);
+#else
+        static_cast<void>(p);
+        return 0;
+#endif
+    }
+
+    bool sample () {
+        return ((runs++ % 8) == 0) && (latency.size() < most);
+    }
+
+    void time (clock::time_point b) {
+        latency.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - b).count());
+    }
+
+    void allocated (const double* p, int s) {
+        if (by_malloc) {
+            live += held(p);
+            peak  = std::max(peak, live);
+        }
+        else {
+            low  = std::min(low,  reinterpret_cast<std::uintptr_t>(p));
+            high = std::max(high, reinterpret_cast<std::uintptr_t>(p + s));
+        }
+    }
+
+    void deallocating (const double* p) {
+        if (by_malloc)
+            live -= held(p);
+    }
+
+    void fragmented (const Heap_Stats& s) {
+        const std::size_t idle = s.free_bytes + s.held_bytes;
+        frag += (idle == 0) ? 0 : 1.0 - static_cast<double>(s.largest_free) / idle;
+        ++made;
+    }
+
+    void report (benchmark::State& state, long items) {
+        state.SetItemsProcessed(items);
+        state.counters["p50_ns"]  = percentile(latency, 0.5);
+        state.counters["p99_ns"]  = percentile(latency, 0.99);
+        state.counters["p999_ns"] = percentile(latency, 0.999);
+    }
+
+    void report_peak (benchmark::State& state) {
+        state.counters["peak_bytes"] = by_malloc ? peak : (high < low) ? 0 : (high - low);
+        if (made != 0)
+            state.counters["fragmentation"] = frag / made;
+    }
+};
+
+/**
+ * true iff A gets its blocks from glibc malloc
+ */
+template <typename A>
+constexpr bool by_malloc =
+#ifdef __GLIBC__
+    std::is_same_v<A, Malloc_Allocator> || std::is_same_v<A, std::allocator<double>>;
+#else
+    false;
+#endif
+
+// -----------
+// BM_Workload
+// -----------
+
+/**
+ * replay the workload on one allocator for as long as it takes
+ * items are requests, latencies include a steady_clock read
+ */
+template <typename A>
+void BM_Workload (benchmark::State& state, const Workload& w) {
+    auto x = make_unique<A>();
+    int  n = 0;
+    for (const Request& r : w)
+        n = std::max(n, r.slot + 1);
+    vector<double*> block(n);
+    vector<int>     size(n);
+    Meter           m(by_malloc<A>);
+    for (auto _ : state) {
+        const bool sample = m.sample();
+        for (const Request& r : w) {
+            if (r.size == 0)
+                m.deallocating(block[r.slot]);
+            const auto b = sample ? Meter::clock::now() : Meter::clock::time_point();
+            if (r.size != 0) {
+                block[r.slot] = x->allocate(r.size);
+                size[r.slot]  = r.size;
+            }
+            else
+                x->deallocate(block[r.slot], size[r.slot]);
+            if (sample)
+                m.time(b);
+            if (r.size != 0)
+                m.allocated(block[r.slot], r.size);
+            if constexpr (requires {x->stats();})
+                if (sample)
+                    m.fragmented(x->stats());
+        }
+        benchmark::ClobberMemory();
+    }
+    m.report(state, state.iterations() * static_cast<long>(w.size()));
+    m.report_peak(state);
+}
+
+// ----
+// ring
+// ----
+
+/**
+ * a bounded queue of blocks from one producer to one consumer
+ * with offset_ptrs, it can be in a heap that processes share
+ */
+template <typename Pointer = double*>
+struct Ring {
+    static constexpr std::size_t size = 1024;
+
+    Pointer                  block[size];
+    std::atomic<std::size_t> head {0}; // next to pop
+    std::atomic<std::size_t> tail {0}; // next to push
+
+    void push (Pointer p) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        while (t - head.load(std::memory_order_acquire) == size)
+            std::this_thread::yield();
+        block[t % size] = p;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    Pointer pop () {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        while (tail.load(std::memory_order_acquire) == h)
+            std::this_thread::yield();
+        Pointer p = block[h % size];
+        head.store(h + 1, std::memory_order_release);
+        return p;
+    }
+};
+
+// --------------------
+// BM_Producer_Consumer
+// --------------------
+
+/**
+ * the benchmark thread allocates blocks of 1 to 16 objects and hands them
+ * to a consumer thread, which deallocates them
+ * items are allocations, latencies are the producer's
+ */
+template <typename A>
+void BM_Producer_Consumer (benchmark::State& state) {
+    constexpr int burst = 4096;
+    auto          x     = make_unique<A>();
+    Ring<>        ring;
+    std::thread   consumer([&] {
+        while (double* p = ring.pop())
+            x->deallocate(p, static_cast<std::size_t>(p[0]));
+    });
+    Meter m(false);
+    for (auto _ : state) {
+        const bool sample = m.sample();
+        for (int i = 0; i != burst; ++i) {
+            const int  s = 1 + i % 16;
+            const auto b = sample ? Meter::clock::now() : Meter::clock::time_point();
+            double*    p = x->allocate(s);
+            if (sample)
+                m.time(b);
+            p[0] = s;
+            ring.push(p);
+        }
+    }
+    ring.push(nullptr);
+    consumer.join();
+    m.report(state, state.iterations() * burst);
+}
+
+#ifdef __linux__
+
+// ---------
+// processes
+// ---------
+
+using shared_type = Shm_Allocator<double, 1 << 22>;
+
+/**
+ * the name of the shared heap of this process
+ */
+std::string shared_name () {
+    return "/bench_Allocator." + std::to_string(getpid());
+}
+
+/**
+ * an object of type U in x's heap, found by the other processes through its root
+ */
+template <typename U>
+U* shared_root (shared_type& x) {
+    U* p = reinterpret_cast<U*>(x.allocate(sizeof(U) / sizeof(double) + 1).get());
+    new (p) U;
+    x.root(x.offset_of(p));
+    return p;
+}
+
+// -----------------
+// BM_Shared_Handoff
+// -----------------
+
+/**
+ * the benchmark process allocates blocks of 1 to 16 objects from a shared
+ * heap and hands them, through a ring in that heap, to a consumer process,
+ * which deallocates them
+ * items are allocations, latencies are the producer's
+ */
+void BM_Shared_Handoff (benchmark::State& state) {
+    using ring_type = Ring<offset_ptr<double>>;
+    constexpr int     burst = 4096;
+    const std::string name  = shared_name();
+    shared_type       x(name.c_str());
+    ring_type&        ring  = *shared_root<ring_type>(x);
+    const pid_t       child = fork();
+    if (child == 0) {
+        shared_type y(name.c_str()); // a mapping of its own, at another address
+        ring_type&  r = *reinterpret_cast<ring_type*>(y.at(y.root()).get());
+        while (offset_ptr<double> p = r.pop())
+            y.deallocate(p, static_cast<std::size_t>(p[0]));
+        std::_Exit(0);
+    }
+    Meter m(false);
+    for (auto _ : state) {
+        const bool sample = m.sample();
+        for (int i = 0; i != burst; ++i) {
+            const int  s = 1 + i % 16;
+            const auto b = sample ? Meter::clock::now() : Meter::clock::time_point();
+            const offset_ptr<double> p = x.allocate(s);
+            if (sample)
+                m.time(b);
+            p[0] = s;
+            ring.push(p);
+        }
+    }
+    ring.push(nullptr);
+    waitpid(child, nullptr, 0);
+    shared_type::unlink(name.c_str());
+    m.report(state, state.iterations() * burst);
+}
+
+// -------------------
+// BM_Shared_Processes
+// -------------------
+
+/**
+ * the benchmark process and range(0) - 1 others each allocate and
+ * deallocate a burst of small requests on one shared heap, as BM_Threads
+ * does with threads
+ * items are the benchmark process's
+ */
+void BM_Shared_Processes (benchmark::State& state) {
+    const std::string  name = shared_name();
+    shared_type        x(name.c_str());
+    std::atomic<bool>& stop = *shared_root<std::atomic<bool>>(x);
+    std::vector<pid_t> children;
+    const auto burst = [] (shared_type& y) {
+        offset_ptr<double> p[8];
+        for (int i = 0; i != 8; ++i)
+            p[i] = y.allocate(1 + i % 4);
+        for (int i = 0; i != 8; ++i)
+            y.deallocate(p[i], 1 + i % 4);
+    };
+    for (int k = 1; k < state.range(0); ++k) {
+        const pid_t child = fork();
+        if (child == 0) {
+            shared_type              y(name.c_str());
+            const std::atomic<bool>& done = *reinterpret_cast<std::atomic<bool>*>(y.at(y.root()).get());
+            while (!done.load(std::memory_order_relaxed))
+                burst(y);
+            std::_Exit(0);
+        }
+        children.push_back(child);
+    }
+    for (auto _ : state)
+        burst(x);
+    stop = true;
+    for (const pid_t child : children)
+        waitpid(child, nullptr, 0);
+    shared_type::unlink(name.c_str());
+    state.SetItemsProcessed(state.iterations() * 16);
+}
+
+#endif // __linux__
+
+// -----------------
+// register_workload
+// -----------------
+
+/**
+ * register the workload under name against each single-threaded allocator
+ */
+void register_workload (const std::string& name, const Workload& w) {
+    const auto v = make_shared<const Workload>(w);
+    benchmark::RegisterBenchmark((name + "/My_Allocator").c_str(),
+        [v] (benchmark::State& state) {BM_Workload<allocator_type>(state, *v);});
+    benchmark::RegisterBenchmark((name + "/My_Allocator/deferred").c_str(),
+        [v] (benchmark::State& state) {BM_Workload<Deferred_Allocator>(state, *v);});
+    benchmark::RegisterBenchmark((name + "/My_Allocator/hardened").c_str(),
+        [v] (benchmark::State& state) {BM_Workload<hardened_type>(state, *v);});
+    benchmark::RegisterBenchmark((name + "/std::allocator").c_str(),
+        [v] (benchmark::State& state) {BM_Workload<std::allocator<double>>(state, *v);});
+    benchmark::RegisterBenchmark((name + "/malloc").c_str(),
+        [v] (benchmark::State& state) {BM_Workload<Malloc_Allocator>(state, *v);});
+}
+
+} // namespace
+
+BENCHMARK(BM_Scan)->Arg(10)->Arg(50)->Arg(90);
+BENCHMARK(BM_Free_List)->Arg(10)->Arg(50)->Arg(90);
+BENCHMARK(BM_Small)->Arg(10)->Arg(50)->Arg(90);
+BENCHMARK_TEMPLATE(BM_Threads, Locked_Allocator<double, 1 << 22>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Threads, Concurrent_Allocator<double, 1 << 22>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Single, Locked_Allocator<double, 1 << 22>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Single, Pool_Allocator<double, 1 << 16>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Producer_Consumer, Locked_Allocator<double, 1 << 22>)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Producer_Consumer, Concurrent_Allocator<double, 1 << 22>)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Producer_Consumer, std::allocator<double>)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Producer_Consumer, Malloc_Allocator)->UseRealTime();
+#ifdef __linux__
+BENCHMARK(BM_Shared_Handoff)->UseRealTime();
+BENCHMARK(BM_Shared_Processes)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+#endif
+
+// ----
+// main
+// ----
+// bench_Allocator [benchmark flags] [--trace=FILE]
+// --trace=FILE also replays the test cases of a run_Allocator input file
+// --benchmark_out=FILE --benchmark_out_format=json writes the results as JSON
+
+int main (int argc, char* argv[]) {
+    benchmark::Initialize(&argc, argv);
+    int rest = 1;
+    for (int i = 1; i != argc; ++i) {
+        if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+            std::ifstream in(argv[i] + 8);
+            if (!in) {
+                std::cerr << "bench_Allocator: cannot read " << (argv[i] + 8) << std::endl;
+                return 1;
+            }
+            register_workload("trace", trace(in));
+        }
+        else
+            argv[rest++] = argv[i];
+    }
+    if (benchmark::ReportUnrecognizedArguments(rest, argv))
+        return 1;
+    register_workload("lifo",      lifo());
+    register_workload("fifo",      fifo());
+    register_workload("uniform",   uniform());
+    register_workload("power_law", power_law());
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -6,92 +6,599 @@
 // includes
 // --------
 
-#include <iostream> // cin, cout
+#include <iostream> // cerr, cout
 #include <vector>   // vector
-#include <sstream>
-#include <algorithm> // sort
+#include <algorithm> // max, min
+#include <atomic>    // atomic
+#include <bit>       // bit_floor
+#include <charconv>  // from_chars, to_chars
+#include <chrono>    // steady_clock
+#include <cstdio>    // FILE, fflush, fwrite, stderr, stdout
+#include <cstring>   // memchr, strcmp, strlen
+#include <memory>    // make_unique, unique_ptr
+#include <string>    // stoi, string, to_string
+#include <string_view> // string_view
+#include <system_error> // errc
+#include <thread>    // hardware_concurrency, jthread
+#include <unordered_map> // unordered_map
+
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // read
 
 #include "Allocator.hpp"
 
 using namespace std;
 
-// ----
-// main
-// ----
-// Main program to use the Allocator
-// #include <iostream>
-// #include <vector>
+// -----
+// Input
+// -----
 
-int main() {
-    int t; // Number of test cases
-    std::cin >> t;
-    std::cin.ignore(); // Clear the newline after reading t
+/**
+ * the lines of a file descriptor, mapped whole if it is a regular file,
+ * read whole in 1 MiB chunks otherwise
+ */
+class Input {
+private:
+    const char*       _p;      // start of the next line
+    const char*       _e;      // end of the input
+    void*             _map;    // the mapping, nullptr if none
+    std::size_t       _length; // of the mapping
+    std::vector<char> _read;   // the input, if it isn't mapped
 
-    // Read the blank line after t
-    std::string line;
-    std::getline(std::cin, line);
+public:
+    explicit Input (int fd) :
+            _map    (nullptr),
+            _length (0) {
+        struct stat st;
+        if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+            _length = st.st_size;
+            _map    = mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (_map == MAP_FAILED)
+                _map = nullptr;
+        }
+        if (_map != nullptr) {
+            madvise(_map, _length, MADV_SEQUENTIAL);
+            _p = static_cast<const char*>(_map);
+        }
+        else {
+            std::size_t n = 0;
+            for (ssize_t r = 1; r > 0; n += r) {
+                _read.resize(n + (1 << 20));
+                r = ::read(fd, _read.data() + n, 1 << 20);
+                if (r < 0)
+                    r = 0;
+            }
+            _read.resize(n);
+            _p = _read.data();
+        }
+        _e = _p + ((_map != nullptr) ? _length : _read.size());
+    }
 
-    // Process each test case
-    for (int i = 0; i < t; ++i) {
-        My_Allocator<int, 1000> allocator; // Initialize the allocator
-        std::vector<int> sentinels; // To store the sentinel values
-        std::vector<My_Allocator<int, 1000>::pointer> busy_blocks;
-
-        // Read requests until a blank line or EOF
-        std::vector<std::string> test_case_lines;
-        while (std::getline(std::cin, line)) {
-            if (line.empty()) {
-                break; // End of current test case
+    Input             (const Input&) = delete;
+    Input& operator = (const Input&) = delete;
+
+    ~Input () {
+        if (_map != nullptr)
+            munmap(_map, _length);
+    }
+
+    /**
+     * the next line, without its newline, in s
+     * return false at the end of the input
+     */
+    bool line (std::string_view& s) {
+        if (_p == _e)
+            return false;
+        const char* n = static_cast<const char*>(std::memchr(_p, '\n', _e - _p));
+        if (n == nullptr)
+            n = _e;
+        s  = std::string_view(_p, n - _p);
+        _p = (n == _e) ? _e : n + 1;
+        return true;
+    }
+};
+
+/**
+ * the int at the start of s, after any blanks and a plus sign, as stoi reads
+ * it, 0 if there is none
+ */
+int to_int (std::string_view s) {
+    std::size_t i = 0;
+    while ((i != s.size()) && ((s[i] == ' ') || (s[i] == '\t')))
+        ++i;
+    if ((i != s.size()) && (s[i] == '+'))
+        ++i;
+    int v = 0;
+    std::from_chars(s.data() + i, s.data() + s.size(), v);
+    return v;
+}
+
+// ------
+// Output
+// ------
+
+/**
+ * a stream, written in 1 MiB blocks
+ */
+class Output {
+private:
+    std::FILE*  _file;
+    std::string _buffer;
+
+public:
+    explicit Output (std::FILE* file) :
+            _file (file) {
+        _buffer.reserve(1 << 20);
+    }
+
+    Output             (const Output&) = delete;
+    Output& operator = (const Output&) = delete;
+
+    ~Output () {
+        flush();
+    }
+
+    Output& operator << (std::string_view s) {
+        _buffer.append(s);
+        if (_buffer.size() >= (1 << 20))
+            flush();
+        return *this;
+    }
+
+    void flush () {
+        std::fwrite(_buffer.data(), 1, _buffer.size(), _file);
+        std::fflush(_file);
+        _buffer.clear();
+    }
+};
+
+// ---------
+// read_case
+// ---------
+
+/**
+ * read requests until a blank line or EOF
+ * return false if there were none left to read
+ */
+bool read_case (Input& in, std::vector<int>& requests) {
+    std::string_view line;
+    bool             read = false;
+    while (in.line(line)) {
+        read = true;
+        if (line.empty()) {
+            break; // End of current test case
+        }
+        requests.push_back(to_int(line));
+    }
+    return read;
+}
+
+// -----------
+// Busy_Blocks
+// -----------
+
+/**
+ * the busy blocks of a heap of the given bytes, in address order, as a
+ * Fenwick tree over the heap's 8-byte slots, a slot counting 1 iff a block
+ * that is busy has its payload there
+ * every payload is 8-aligned in the heap, whose own alignment is at least 8
+ */
+template <typename P>
+class Busy_Blocks {
+private:
+    const char*      _base;
+    std::vector<int> _tree; // 1-based, _tree[i] counts the slots from i - lowbit(i) up to i
+    std::size_t      _size;
+
+    std::size_t slot (P p) const {
+        const std::size_t d = reinterpret_cast<const char*>(p) - _base;
+        assert(d % 8 == 0);
+        return d / 8;
+    }
+
+    void add (std::size_t i, int v) {
+        for (++i; i < _tree.size(); i += i & -i)
+            _tree[i] += v;
+    }
+
+public:
+    Busy_Blocks (const void* base, std::size_t bytes) :
+            _base (static_cast<const char*>(base)),
+            _tree (bytes / 8 + 2, 0),
+            _size (0)
+        {}
+
+    /**
+     * O(1) in time
+     */
+    std::size_t size () const {
+        return _size;
+    }
+
+    /**
+     * O(log n) in time
+     */
+    void insert (P p) {
+        add(slot(p), 1);
+        ++_size;
+    }
+
+    /**
+     * O(log n) in time
+     */
+    void erase (P p) {
+        add(slot(p), -1);
+        --_size;
+    }
+
+    /**
+     * O(log n) in time
+     * the k-th busy block in address order, from 0
+     */
+    P operator [] (std::size_t k) const {
+        std::size_t i = 0;
+        for (std::size_t step = std::bit_floor(_tree.size() - 1); step != 0; step /= 2) {
+            if ((i + step < _tree.size()) && (static_cast<std::size_t>(_tree[i + step]) <= k)) {
+                i += step;
+                k -= _tree[i];
             }
-            test_case_lines.push_back(line);
         }
+        return reinterpret_cast<P>(const_cast<char*>(_base) + 8 * i);
+    }
+};
 
-        // Process each request in the current test case
-        for (const auto& request_line : test_case_lines) {
-            int request = std::stoi(request_line);
+/**
+ * the My_Heap behind an allocator, or behind the allocator a Recording_Allocator wraps
+ */
+template <typename A>
+const auto& heap_of (const A& allocator) {
+    if constexpr (requires {allocator.heap().heap();})
+        return allocator.heap().heap();
+    else
+        return allocator.heap();
+}
 
-            if (request > 0) {
-                // Allocation request
+// ------
+// replay
+// ------
+
+/**
+ * process each request against the allocator
+ * report failed requests on log, if it isn't nullptr
+ * return the number of failed requests
+ */
+template <typename A>
+int replay (A& allocator, const std::vector<int>& requests, std::string* log) {
+    const auto& heap = heap_of(allocator);
+    Busy_Blocks<typename A::pointer> busy_blocks(&heap, sizeof(heap));
+    int failures = 0;
+
+    for (int request : requests) {
+        if (request > 0) {
+            // Allocation request
+            try {
+                busy_blocks.insert(allocator.allocate(request));
+            } catch (const std::bad_alloc& e) {
+                ++failures;
+                if (log)
+                    *log += std::string("Allocation failed: ") + e.what() + '\n';
+                // Do not add to busy_blocks; indices remain consistent
+            }
+        } else {
+            // Deallocation request
+            std::size_t blockIndex = static_cast<std::size_t>(-request - 1); // Convert to zero-based index
+            if (blockIndex < busy_blocks.size()) {
+                const auto ptr = busy_blocks[blockIndex];
                 try {
-                    auto ptr = allocator.allocate(request);
-                    busy_blocks.push_back(ptr);
-                    // sort by pointer value
-                    std::sort(busy_blocks.begin(), busy_blocks.end());
-                } catch (const std::bad_alloc& e) {
-                    std::cerr << "Allocation failed: " << e.what() << std::endl;
-                    // Do not add to busy_blocks; indices remain consistent
+                    allocator.deallocate(ptr, 0);
+                    // Remove the block from busy_blocks to keep indices consistent
+                    busy_blocks.erase(ptr);
+                } catch (const std::invalid_argument& e) {
+                    ++failures;
+                    if (log)
+                        *log += std::string("Deallocation failed: ") + e.what() + '\n';
                 }
             } else {
-                // Deallocation request
-                std::size_t blockIndex = static_cast<std::size_t>(-request - 1); // Convert to zero-based index
-                if (blockIndex < busy_blocks.size()) {
-                    try {
-                        allocator.deallocate(busy_blocks[blockIndex], 0);
-                        // Remove the block from busy_blocks to keep indices consistent
-                        busy_blocks.erase(busy_blocks.begin() + blockIndex);
-                    } catch (const std::invalid_argument& e) {
-                        std::cerr << "Deallocation failed: " << e.what() << std::endl;
-                    }
-                } else {
-                    std::cerr << "Invalid block index for deallocation: " << blockIndex + 1 << std::endl;
-                }
+                ++failures;
+                if (log)
+                    *log += "Invalid block index for deallocation: " + std::to_string(blockIndex + 1) + '\n';
             }
         }
+    }
+    return failures;
+}
+
+// -------------
+// fragmentation
+// -------------
+
+/**
+ * 1 - largest free block / total free bytes, 0 if nothing is free
+ */
+template <typename A>
+double fragmentation (const A& allocator) {
+    long total   = 0;
+    long largest = 0;
+    for (auto it = allocator.begin(); it != allocator.end(); ++it) {
+        if (*it > 0) {
+            total  += *it;
+            largest = std::max<long>(largest, *it);
+        }
+    }
+    return (total == 0) ? 0.0 : 1.0 - static_cast<double>(largest) / total;
+}
+
+// -------
+// compare
+// -------
 
-        // Gather and store sentinel values after processing all requests
-        for (auto it = allocator.begin(); it != allocator.end(); ++it) {
-            sentinels.push_back(*it);
+/**
+ * replay every test case reps times under one placement policy
+ * report requests per second, mean fragmentation after each test case,
+ * and failed requests
+ */
+template <typename Policy>
+void compare (const char* name, const std::vector<std::vector<int>>& cases, int reps) {
+    using allocator_type = My_Allocator<double, 1000, Policy>;
+
+    long   requests = 0;
+    long   failures = 0;
+    double fragment = 0;
+    auto   elapsed  = std::chrono::steady_clock::duration::zero();
+
+    for (int r = 0; r != reps; ++r) {
+        for (const auto& requests_of_case : cases) {
+            allocator_type allocator;
+            const auto b = std::chrono::steady_clock::now();
+            failures += replay(allocator, requests_of_case, nullptr);
+            elapsed  += std::chrono::steady_clock::now() - b;
+            requests += requests_of_case.size();
+            if (r == 0)
+                fragment += fragmentation(allocator);
         }
+    }
 
-        // Output the sentinels for the current test case
-        for (size_t k = 0; k < sentinels.size(); ++k) {
-            std::cout << sentinels[k];
-            if (k < sentinels.size() - 1) {
-                std::cout << " ";
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << name
+              << " requests/s " << ((seconds == 0) ? 0 : requests / seconds)
+              << " fragmentation " << (cases.empty() ? 0 : fragment / cases.size())
+              << " failures " << failures / reps << "\n";
+}
+
+// ------------
+// replay_trace
+// ------------
+
+/**
+ * stream a binary trace through a Growable_Allocator under one placement
+ * policy, keeping only the live blocks in memory
+ * report requests per second, failed requests, and chunks mapped
+ * a request on an object whose allocation failed fails too
+ */
+template <typename Policy>
+void replay_trace (const char* name, const char* path) {
+    using allocator_type = Growable_Allocator<char, (1 << 24), Policy>;
+
+    allocator_type                                            allocator;
+    std::unordered_map<std::uint64_t, std::pair<char*, std::uint32_t>> live;
+    Trace_Reader                                              in(path);
+    Trace_Record                                              r;
+    long                                                      requests = 0;
+    long                                                      failures = 0;
+
+    const auto b = std::chrono::steady_clock::now();
+    while (in.next(r)) {
+        ++requests;
+        if (r.op == Trace_Record::allocate) {
+            try {
+                live[r.id] = {allocator.allocate(r.bytes), r.bytes};
             }
+            catch (const std::bad_alloc&) {
+                ++failures;
+            }
+            continue;
+        }
+        const auto i = live.find(r.id);
+        if (i == live.end()) {
+            ++failures;
+            continue;
         }
-        std::cout << std::endl; // New line after each test case output
+        if (r.op == Trace_Record::reallocate) {
+            try {
+                i->second = {allocator.reallocate(i->second.first, i->second.second, r.bytes), r.bytes};
+            }
+            catch (const std::bad_alloc&) {
+                ++failures;
+            }
+        }
+        else {
+            allocator.deallocate(i->second.first, i->second.second);
+            live.erase(i);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - b).count();
+    std::cout << name
+              << " requests/s " << ((seconds == 0) ? 0 : requests / seconds)
+              << " failures " << failures
+              << " chunks " << allocator.chunks() << "\n";
+}
+
+// -----
+// print
+// -----
+
+/**
+ * print the sentinels of the allocator on one line of out
+ */
+template <typename A>
+void print (const A& allocator, std::string& out) {
+    char b[24];
+    for (auto it = allocator.begin(); it != allocator.end(); ++it) {
+        if (it != allocator.begin())
+            out += ' ';
+        out.append(b, std::to_chars(b, b + sizeof(b), static_cast<long>(*it)).ptr);
+    }
+    out += '\n'; // New line after each test case output
+}
+
+// --------
+// run_case
+// --------
+
+/**
+ * replay one test case against an allocator of its own, recording a trace
+ * if trace isn't nullptr
+ * append its sentinels to out, and its failed requests to err
+ */
+void run_case (const std::vector<int>& requests, Trace_Writer* trace, std::string& out, std::string& err) {
+    if (trace) {
+        Recording_Allocator<My_Allocator<double, 1000>> allocator(*trace);
+        replay(allocator, requests, &err);
+        print(allocator.heap(), out);
+    }
+    else {
+        My_Allocator<double, 1000> allocator; // Initialize the allocator, objects are 8 bytes
+        replay(allocator, requests, &err);
+        print(allocator, out);
+    }
+}
+
+// ---------
+// run_cases
+// ---------
+
+/**
+ * run the test cases on a pool of threads, each against its own allocator,
+ * writing their sentinels and failed requests in input order, as the
+ * serial run does, as soon as each case and those before it are done
+ */
+void run_cases (const std::vector<std::vector<int>>& cases, unsigned threads, Output& out, Output& err) {
+    struct result {
+        std::string       out;
+        std::string       err;
+        std::atomic<bool> done = false;
+    };
+    std::vector<result>      results(cases.size());
+    std::atomic<std::size_t> next = 0;
+    std::vector<std::jthread> pool;
+    for (unsigned k = 0; k != threads; ++k)
+        pool.emplace_back([&] {
+            for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < cases.size(); ) {
+                run_case(cases[i], nullptr, results[i].out, results[i].err);
+                results[i].done.store(true, std::memory_order_release);
+                results[i].done.notify_one();
+            }
+        });
+    for (auto& r : results) {
+        r.done.wait(false, std::memory_order_acquire);
+        err << r.err;
+        out << r.out;
+        std::string().swap(r.out);
+        std::string().swap(r.err);
+    }
+}
+
+// -----
+// usage
+// -----
+
+/**
+ * print how to run the program to stderr
+ * return the exit status for a bad command line
+ */
+int usage (const char* name) {
+    std::cerr << "usage: " << name << "                 print the sentinels of each test case\n"
+              << "       " << name << " --policies [R]  replay the test cases R times under each placement policy\n"
+              << "       " << name << " --record FILE   print the sentinels, recording a binary trace to FILE\n"
+              << "       " << name << " --replay FILE   stream the binary trace in FILE under each placement policy\n"
+              << "       " << name << " -j N            print the sentinels, running N test cases at a time, 0 for one per core\n";
+    return 2;
+}
+
+// ----
+// main
+// ----
+// Main program to use the Allocator
+// run_Allocator                 print the sentinels of each test case
+// run_Allocator --policies [R]  replay the test cases R times (default 1) under each placement policy
+// run_Allocator --record FILE   print the sentinels of each test case, recording a binary trace to FILE
+// run_Allocator --replay FILE   stream the binary trace in FILE under each placement policy
+// run_Allocator -j N            print the sentinels of each test case, running N at a time, 0 for one per core,
+//                               at most one per core, with a note on stderr if N is more, and one per test case
+
+int main(int argc, char* argv[]) {
+    // Check the thread count before reading any input
+    unsigned threads = 0;
+    const bool parallel = (argc > 1) && (std::strcmp(argv[1], "-j") == 0);
+    if (parallel) {
+        const char* const b = (argc > 2) ? argv[2] : "";
+        const char* const e = b + std::strlen(b);
+        const auto        r = std::from_chars(b, e, threads);
+        if ((b == e) || (r.ec != std::errc()) || (r.ptr != e))
+            return usage(argv[0]);
+        const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+        if (threads > cores)
+            std::cerr << argv[0] << ": -j " << threads << " capped at " << cores << ", the number of cores\n";
+        if ((threads == 0) || (threads > cores))
+            threads = cores;
+    }
+
+    if ((argc > 2) && (std::strcmp(argv[1], "--replay") == 0)) {
+        replay_trace<First_Fit>  ("first_fit  ", argv[2]);
+        replay_trace<Next_Fit>   ("next_fit   ", argv[2]);
+        replay_trace<Best_Fit>   ("best_fit   ", argv[2]);
+        replay_trace<Good_Fit<4>>("good_fit<4>", argv[2]);
+        return 0;
+    }
+
+    std::unique_ptr<Trace_Writer> trace;
+    if ((argc > 2) && (std::strcmp(argv[1], "--record") == 0))
+        trace = std::make_unique<Trace_Writer>(argv[2]);
+
+    Input            in(0);
+    std::string_view line;
+    const int t = in.line(line) ? to_int(line) : 0; // Number of test cases
+
+    // Read the blank line after t
+    in.line(line);
+
+    if ((argc > 1) && (std::strcmp(argv[1], "--policies") == 0)) {
+        const int reps = (argc > 2) ? std::max(std::stoi(argv[2]), 1) : 1;
+        std::vector<std::vector<int>> cases(t);
+        for (auto& requests : cases)
+            read_case(in, requests);
+        compare<First_Fit>  ("first_fit  ", cases, reps);
+        compare<Next_Fit>   ("next_fit   ", cases, reps);
+        compare<Best_Fit>   ("best_fit   ", cases, reps);
+        compare<Good_Fit<4>>("good_fit<4>", cases, reps);
+        return 0;
+    }
+
+    Output out(stdout);
+    Output err(stderr);
+
+    if (parallel) {
+        std::vector<std::vector<int>> cases(t);
+        for (auto& requests : cases)
+            read_case(in, requests);
+        run_cases(cases, std::min<unsigned>(threads, cases.size()), out, err);
+        return 0;
+    }
+
+    // Process each test case
+    std::vector<int> requests;
+    std::string      o;
+    std::string      e;
+    for (int i = 0; i < t; ++i) {
+        requests.clear();
+        o.clear();
+        e.clear();
+        read_case(in, requests);
+        run_case(requests, trace.get(), o, e);
+        err << e;
+        out << o;
     }
 
     return 0;
-}
\ No newline at end of file
+}
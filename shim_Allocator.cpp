@@ -0,0 +1,358 @@
+// -----------------
+// ShimAllocator.cpp
+// -----------------
+
+// malloc, free, and the rest of the C allocation interface on the
+// boundary-tag heap of Allocator.hpp, to be preloaded into programs that
+// know nothing about it
+// LD_PRELOAD=./shim_Allocator.so program
+
+// --------
+// includes
+// --------
+
+#include <algorithm> // max, min
+#include <atomic>    // atomic
+#include <bit>       // bit_ceil, has_single_bit
+#include <cerrno>    // EINVAL, ENOMEM, errno
+#include <climits>   // INT_MIN
+#include <cstddef>   // size_t
+#include <cstdint>   // uintptr_t
+#include <cstdlib>   // abort
+#include <cstring>   // memcpy, memset
+#include <mutex>     // lock_guard, recursive_mutex
+#include <new>       // bad_alloc, new
+
+#include <malloc.h>   // malloc_usable_size, memalign, pvalloc, valloc
+#include <pthread.h>  // pthread_atfork
+#include <sys/mman.h> // mmap, munmap
+#include <unistd.h>   // sysconf, write
+
+#include "Allocator.hpp"
+
+namespace {
+
+// Every block is 16-byte aligned, as glibc's are. Requests of at least
+// `large` bytes get a mapping of their own, with the length of the mapping
+// and the offset of the block in it in the 16 bytes before the block. The
+// rest come from a Growable_Allocator. When a larger alignment is asked
+// for, the block is allocated that much larger and the aligned address in
+// it is returned, with its distance from the start of the block two ints
+// before it and `shifted` in the int just before it. That int is otherwise
+// the block's own header, which is never `shifted`, as no block is 2 GiB,
+// not even once it is freed.
+
+constexpr std::size_t chunk = 1 << 24;
+constexpr std::size_t large = chunk / 16;
+constexpr std::size_t align = 16;
+constexpr int         shifted = INT_MIN;
+
+using heap_type = Growable_Allocator<char, chunk, First_Fit, align>;
+using boot_type = My_Heap<(1 << 16), First_Fit, align>;
+
+// ----
+// boot
+// ----
+
+/**
+ * the heap that serves the requests made while the main heap is being
+ * constructed, which allocates its bookkeeping with new
+ */
+boot_type& boot () {
+    static boot_type x;
+    return x;
+}
+
+std::atomic<bool> booting = false;
+
+bool from_boot (const void* q) {
+    const char* b = reinterpret_cast<const char*>(&boot());
+    return (b <= q) && (q < b + sizeof(boot_type));
+}
+
+// ----
+// heap
+// ----
+
+/**
+ * serializes the heaps
+ * recursive, because a bad_alloc thrown inside the heap allocates
+ */
+std::recursive_mutex& lock () {
+    static std::recursive_mutex m;
+    return m;
+}
+
+heap_type& heap () {
+    alignas(heap_type) static unsigned char space[sizeof(heap_type)];
+    static heap_type* x = [] {
+        booting = true;
+        heap_type* h = new (space) heap_type; // never destroyed, there may be frees after exit
+        // the child's only thread isn't the owner of the lock, so it gets a new one
+        pthread_atfork([] {lock().lock();}, [] {lock().unlock();}, [] {new (&lock()) std::recursive_mutex;});
+        booting = false;
+        return h;
+    }();
+    return *x;
+}
+
+/**
+ * write the message to stderr and abort, as glibc does on a bad free
+ */
+[[noreturn]] void die (const char* message) {
+    static_cast<void>(write(2, message, std::strlen(message)));
+    std::abort();
+}
+
+// -----
+// large
+// -----
+
+std::size_t page () {
+    static const std::size_t p = sysconf(_SC_PAGESIZE);
+    return p;
+}
+
+void* map_large (std::size_t n, std::size_t a) {
+    const std::size_t extra  = (a > align) ? a : 0;
+    if (n > SIZE_MAX - 2 * align - extra)
+        return nullptr;
+    const std::size_t length = (n + align + extra + page() - 1) / page() * page();
+    void* m = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED)
+        return nullptr;
+    const std::uintptr_t b = reinterpret_cast<std::uintptr_t>(m);
+    const std::uintptr_t q = (b + align + a - 1) & ~std::uintptr_t(a - 1);
+    reinterpret_cast<std::size_t*>(q)[-2] = length;
+    reinterpret_cast<std::size_t*>(q)[-1] = q - b;
+    return reinterpret_cast<void*>(q);
+}
+
+// ---------
+// allocate
+// ---------
+
+/**
+ * a block of at least n bytes aligned to a, a power of two, nullptr if
+ * there is no room for one
+ */
+void* allocate (std::size_t n, std::size_t a) {
+    a = std::max(a, align);
+    if ((a >= large) || (n >= large - a))
+        return map_large(n, a);
+    const std::size_t want = n + ((a > align) ? a : 0);
+    char* p = nullptr;
+    if (booting) {
+        std::lock_guard<std::recursive_mutex> guard(lock());
+        p = boot().try_allocate(std::max<std::size_t>(want, 1));
+    }
+    else {
+        heap_type& h = heap();
+        std::lock_guard<std::recursive_mutex> guard(lock());
+        try {
+            p = h.allocate(std::max<std::size_t>(want, 1));
+        }
+        catch (const std::bad_alloc&) {
+            return nullptr;
+        }
+    }
+    if ((p == nullptr) || (a == align))
+        return p;
+    char* q = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(p) + a - 1) & ~std::uintptr_t(a - 1));
+    if (q != p) {
+        reinterpret_cast<int*>(q)[-2] = static_cast<int>(q - p);
+        reinterpret_cast<int*>(q)[-1] = shifted;
+    }
+    return q;
+}
+
+/**
+ * the start of the heap block of q, which may be aligned inside it
+ */
+char* block (void* q) {
+    const int* t = static_cast<int*>(q);
+    return static_cast<char*>(q) - ((t[-1] == shifted) ? t[-2] : 0);
+}
+
+// ------
+// usable
+// ------
+
+std::size_t usable (void* q) {
+    if (from_boot(q)) {
+        char* p = block(q);
+        return boot().capacity(p) - (static_cast<char*>(q) - p);
+    }
+    heap_type& h = heap();
+    std::lock_guard<std::recursive_mutex> guard(lock());
+    if (!h.owns(q)) {
+        const std::size_t* s = static_cast<std::size_t*>(q);
+        return s[-2] - s[-1];
+    }
+    char* p = block(q);
+    try {
+        return h.capacity(p) - (static_cast<char*>(q) - p);
+    }
+    catch (const std::invalid_argument&) {
+        die("shim_Allocator: malloc_usable_size(): invalid pointer\n");
+    }
+}
+
+// ------
+// resize
+// ------
+
+/**
+ * resize the block at q, of u usable bytes, to n bytes with the heap's
+ * reallocate, in place when its block or its chunk has room, into r,
+ * nullptr if there is no room anywhere
+ * return false, leaving q alone, if q isn't at the start of a block of the
+ * main heap, or n bytes need a mapping of their own, so that the caller
+ * copies it instead
+ */
+bool resize (void* q, std::size_t u, std::size_t n, void*& r) {
+    if (from_boot(q) || (n >= large - align))
+        return false;
+    heap_type& h = heap();
+    std::lock_guard<std::recursive_mutex> guard(lock());
+    if (!h.owns(q) || (block(q) != q))
+        return false;
+    try {
+        r = h.reallocate(static_cast<char*>(q), u, n);
+    }
+    catch (const std::bad_alloc&) {
+        r = nullptr;
+    }
+    catch (const std::invalid_argument&) {
+        die("shim_Allocator: realloc(): invalid pointer\n");
+    }
+    return true;
+}
+
+// ----------
+// deallocate
+// ----------
+
+void deallocate (void* q) {
+    if (q == nullptr)
+        return;
+    try {
+        if (from_boot(q)) {
+            std::lock_guard<std::recursive_mutex> guard(lock());
+            boot().deallocate(block(q), 0);
+            return;
+        }
+        heap_type& h = heap();
+        std::lock_guard<std::recursive_mutex> guard(lock());
+        if (h.owns(q)) {
+            h.deallocate(block(q), 0);
+            return;
+        }
+    }
+    catch (const std::invalid_argument&) {
+        die("shim_Allocator: free(): invalid pointer or double free\n");
+    }
+    const std::size_t* s = static_cast<std::size_t*>(q);
+    munmap(static_cast<char*>(q) - s[-1], s[-2]);
+}
+
+} // namespace
+
+// ---------------
+// the C interface
+// ---------------
+
+extern "C" {
+
+void* malloc (std::size_t n) noexcept {
+    void* q = allocate(n, align);
+    if (q == nullptr)
+        errno = ENOMEM;
+    return q;
+}
+
+void free (void* q) noexcept {
+    deallocate(q);
+}
+
+void* calloc (std::size_t k, std::size_t n) noexcept {
+    if ((n != 0) && (k > SIZE_MAX / n)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    void* q = malloc(k * n);
+    if ((q != nullptr) && (k * n < large))
+        std::memset(q, 0, k * n);
+    return q;
+}
+
+void* realloc (void* q, std::size_t n) noexcept {
+    if (q == nullptr)
+        return malloc(n);
+    if (n == 0) {
+        free(q);
+        return nullptr;
+    }
+    const std::size_t u = usable(q);
+    if ((n <= u) && (n >= u / 2))
+        return q;
+    void* r = nullptr;
+    if (resize(q, u, n, r)) {
+        if (r == nullptr)
+            errno = ENOMEM;
+        return r;
+    }
+    r = malloc(n);
+    if (r == nullptr)
+        return nullptr;
+    std::memcpy(r, q, std::min(n, u));
+    free(q);
+    return r;
+}
+
+void* reallocarray (void* q, std::size_t k, std::size_t n) noexcept {
+    if ((n != 0) && (k > SIZE_MAX / n)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return realloc(q, k * n);
+}
+
+int posix_memalign (void** r, std::size_t a, std::size_t n) noexcept {
+    if ((a < sizeof(void*)) || !std::has_single_bit(a) || (a > (1u << 30)))
+        return EINVAL;
+    void* q = allocate(n, a);
+    if (q == nullptr)
+        return ENOMEM;
+    *r = q;
+    return 0;
+}
+
+void* aligned_alloc (std::size_t a, std::size_t n) noexcept {
+    if (!std::has_single_bit(a) || (a > (1u << 30))) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    void* q = allocate(n, a);
+    if (q == nullptr)
+        errno = ENOMEM;
+    return q;
+}
+
+void* memalign (std::size_t a, std::size_t n) noexcept {
+    return aligned_alloc(std::bit_ceil(std::max<std::size_t>(a, 1)), n);
+}
+
+void* valloc (std::size_t n) noexcept {
+    return aligned_alloc(page(), n);
+}
+
+void* pvalloc (std::size_t n) noexcept {
+    return aligned_alloc(page(), (n + page() - 1) / page() * page());
+}
+
+std::size_t malloc_usable_size (void* q) noexcept {
+    return (q == nullptr) ? 0 : usable(q);
+}
+
+} // extern "C"
@@ -11,7 +11,21 @@
 
 #include <algorithm> // count
 #include <cstddef>   // ptrdiff_t
+#include <cstdint>   // uint64_t, uintptr_t
+#include <cstdio>    // fopen, fseek, fwrite, remove
+#include <cstdlib>   // _Exit
+#include <cstring>   // memset
+#include <list>      // list
+#include <map>       // map
+#include <memory_resource> // pmr::memory_resource
+#include <memory>    // allocator_traits
 #include <string>    // string
+#include <thread>    // thread
+#include <unordered_map> // pmr::unordered_map, unordered_map
+#include <vector>    // vector
+
+#include <sys/wait.h> // wait, waitpid
+#include <unistd.h>   // fork, getpid
 
 #include "gtest/gtest.h"
 
@@ -239,4 +253,1238 @@ TEST(AllocatorFixture, test9) {
 
     x.deallocate(b3, s1);
     x.deallocate(b4, s1);
-}
\ No newline at end of file
+}
+TEST(AllocatorFixture, test10) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  b1 = x.allocate(1);
+    const pointer  b2 = x.allocate(1);
+    const pointer  b3 = x.allocate(1);
+    ASSERT_EQ(x[48], 944);
+
+    x.deallocate(b2, 1);
+    ASSERT_EQ(x[16],   8);
+    x.deallocate(b1, 1);
+    ASSERT_EQ(x[ 0],  24);
+    ASSERT_EQ(x[28],  24);
+    x.deallocate(b3, 1);
+    ASSERT_EQ(x[  0], 992);
+    ASSERT_EQ(x[996], 992);
+}
+
+TEST(AllocatorFixture, test11) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  b1 = x.allocate(1);
+    const pointer  b2 = x.allocate(1);
+    const pointer  b3 = x.allocate(1);
+
+    x.deallocate(b3, 1);
+    x.deallocate(b1, 1);
+    ASSERT_EQ(x[32], 960);
+
+    const pointer b4 = x.allocate(1);
+    const pointer b5 = x.allocate(2);
+    ASSERT_EQ(b4, b1);
+    ASSERT_EQ(b5, b3);
+
+    x.deallocate(b2, 1);
+    x.deallocate(b4, 1);
+    x.deallocate(b5, 2);
+    ASSERT_EQ(x[0], 992);
+}
+
+TEST(AllocatorFixture, test12) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  b1 = x.allocate(3);
+    const pointer  b2 = x.allocate(1);
+    const pointer  b3 = x.allocate(1);
+    const pointer  b4 = x.allocate(1);
+
+    x.deallocate(b1, 3);
+    x.deallocate(b3, 1);
+
+    // the lowest block that fits wins, even over an exact fit higher up
+    const pointer b5 = x.allocate(1);
+    const pointer b6 = x.allocate(1);
+    const pointer b7 = x.allocate(1);
+    ASSERT_EQ(b5, b1);
+    ASSERT_EQ(b6, b1 + 2);
+    ASSERT_EQ(b7, b3);
+    ASSERT_EQ(x[0],  -8);
+    ASSERT_EQ(x[16], -8);
+
+    x.deallocate(b2, 1);
+    x.deallocate(b4, 1);
+    x.deallocate(b5, 1);
+    x.deallocate(b6, 1);
+    x.deallocate(b7, 1);
+    ASSERT_EQ(x[0], 992);
+}
+
+TEST(AllocatorFixture, test13) {
+    using allocator_type = My_Allocator<double, 1000, Next_Fit>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  b1 = x.allocate(4);
+    const pointer  b2 = x.allocate(1);
+    x.deallocate(b1, 4);
+
+    // the search resumes after b2 instead of going back to b1
+    const pointer b3 = x.allocate(2);
+    ASSERT_EQ(b3, b2 + 2);
+
+    // until nothing fits after the previous allocation
+    const pointer b4 = x.allocate(114);
+    const pointer b5 = x.allocate(2);
+    ASSERT_EQ(b5, b1);
+
+    x.deallocate(b2, 1);
+    x.deallocate(b3, 2);
+    x.deallocate(b4, 114);
+    x.deallocate(b5, 2);
+    ASSERT_EQ(x[0], 992);
+}
+
+TEST(AllocatorFixture, test14) {
+    using allocator_type = My_Allocator<double, 4000, Best_Fit>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  b1 = x.allocate(50);
+    const pointer  b2 = x.allocate(1);
+    const pointer  b3 = x.allocate(33);
+    const pointer  b4 = x.allocate(1);
+    x.deallocate(b3, 33);
+    x.deallocate(b1, 50);
+
+    const pointer b5 = x.allocate(33);
+    ASSERT_EQ(b5, b3);
+
+    x.deallocate(b2, 1);
+    x.deallocate(b4, 1);
+    x.deallocate(b5, 33);
+    ASSERT_EQ(x[0], 3992);
+}
+
+TEST(AllocatorFixture, test15) {
+    using allocator_type = My_Allocator<double, 4000, Good_Fit<1>>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  b1 = x.allocate(50);
+    const pointer  b2 = x.allocate(1);
+    const pointer  b3 = x.allocate(33);
+    const pointer  b4 = x.allocate(1);
+    x.deallocate(b3, 33);
+    x.deallocate(b1, 50);
+
+    // the first candidate of the bin is taken, not the smallest
+    const pointer b5 = x.allocate(33);
+    ASSERT_EQ(b5, b1);
+
+    x.deallocate(b2, 1);
+    x.deallocate(b4, 1);
+    x.deallocate(b5, 33);
+    ASSERT_EQ(x[0], 3992);
+}
+
+TEST(AllocatorFixture, test16) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  b1 = x.allocate(1);
+    const pointer  b2 = x.allocate(3);
+    const pointer  b3 = x.allocate(1);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(b1) % 8, 0u);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(b2) % 8, 0u);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(b3) % 8, 0u);
+
+    x.deallocate(b1, 1);
+    x.deallocate(b2, 3);
+    x.deallocate(b3, 1);
+}
+
+TEST(AllocatorFixture, test17) {
+    struct B {
+        char c[24];
+    };
+    using allocator_type = My_Allocator<B, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    // blocks are sized by sizeof(T), not by 8 bytes per object
+    allocator_type x;
+    const pointer  b1 = x.allocate(2);
+    ASSERT_EQ(x[ 0], -48);
+    ASSERT_EQ(x[52], -48);
+    ASSERT_EQ(x[56], 936);
+
+    x.deallocate(b1, 2);
+    ASSERT_EQ(x[0], 992);
+}
+
+TEST(AllocatorFixture, test18) {
+    using allocator_type = My_Allocator<char, 1000, First_Fit, 64>;
+    using pointer        = typename allocator_type::pointer;
+
+    // the heap is cut to a multiple of 64 bytes, and every block spans a multiple of 64
+    allocator_type x;
+    ASSERT_EQ(x[  0], 952);
+    ASSERT_EQ(x[956], 952);
+
+    const pointer b1 = x.allocate(1);
+    const pointer b2 = x.allocate(100);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(b1) % 64, 0u);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(b2) % 64, 0u);
+    ASSERT_EQ(x[ 0],  -56);
+    ASSERT_EQ(x[64], -120);
+
+    x.deallocate(b1, 1);
+    x.deallocate(b2, 100);
+    ASSERT_EQ(x[0], 952);
+}
+
+TEST(AllocatorFixture, test19) {
+    using allocator_type = Concurrent_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    // a freed block is served again from this thread's cache
+    allocator_type x;
+    const pointer  b1 = x.allocate(2);
+    x.deallocate(b1, 2);
+    const pointer  b2 = x.allocate(2);
+    ASSERT_EQ(b1, b2);
+    x.deallocate(b2, 2);
+
+    // and the cache gives way to a request that needs the whole heap
+    const pointer b3 = x.allocate(124);
+    x.deallocate(b3, 124);
+
+    // a thread whose cached block the heap refuses still exits
+    Concurrent_Allocator<double, 1000, Hardened<First_Fit>> y;
+    std::thread([&y] () {
+        double* const p = y.allocate(1);
+        y.deallocate(p, 1);
+        reinterpret_cast<char*>(p)[12] ^= 1; // the canary, in the last word of its 16 bytes
+    }).join();
+}
+
+TEST(AllocatorFixture, test20) {
+    using allocator_type = Concurrent_Allocator<double, 1 << 16>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type       x;
+    std::vector<pointer> v[4];
+
+    // each thread allocates, frees half of its blocks, and hands the rest on
+    std::vector<std::thread> producers;
+    for (int t = 0; t != 4; ++t)
+        producers.emplace_back([&x, &v, t] () {
+            for (int i = 0; i != 200; ++i) {
+                const pointer p = x.allocate(1 + i % 4);
+                if (i % 2 == 0)
+                    x.deallocate(p, 1 + i % 4);
+                else
+                    v[t].push_back(p);
+            }
+        });
+    for (auto& t : producers)
+        t.join();
+
+    // the other threads free them
+    std::vector<std::thread> consumers;
+    for (int t = 0; t != 4; ++t)
+        consumers.emplace_back([&x, &v, t] () {
+            for (std::size_t i = 0; i != v[(t + 1) % 4].size(); ++i)
+                x.deallocate(v[(t + 1) % 4][i], 1 + (2 * i + 1) % 4);
+        });
+    for (auto& t : consumers)
+        t.join();
+
+    // every thread cache went back to the heap, which coalesced to one block
+    const pointer b = x.allocate(((1 << 16) - 8) / 8);
+    x.deallocate(b, ((1 << 16) - 8) / 8);
+}
+
+TEST(AllocatorFixture, test21) {
+    using allocator_type = Pool_Allocator<double, 3>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    ASSERT_THROW(x.allocate(2), std::bad_alloc);
+
+    const pointer b1 = x.allocate(1);
+    const pointer b2 = x.allocate(1);
+    const pointer b3 = x.allocate(1);
+    ASSERT_THROW(x.allocate(1), std::bad_alloc);
+    x.construct(b1, 1.0);
+    x.construct(b3, 3.0);
+
+    x.deallocate(b2, 1);
+    ASSERT_THROW(x.deallocate(b2, 1), std::invalid_argument);
+
+    // only the live slots are visited
+    std::vector<double> v;
+    for (auto it = x.begin(); it != x.end(); ++it)
+        v.push_back(*it);
+    ASSERT_EQ(v, std::vector<double>({1.0, 3.0}));
+
+    const pointer b4 = x.allocate(1);
+    ASSERT_EQ(b4, b2);
+
+    x.deallocate(b1, 1);
+    x.deallocate(b3, 1);
+    x.deallocate(b4, 1);
+    ASSERT_TRUE(x.begin() == x.end());
+}
+
+TEST(AllocatorFixture, test22) {
+    using allocator_type = Pool_Allocator<int, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t)
+        threads.emplace_back([&x] () {
+            pointer p[100];
+            for (int r = 0; r != 100; ++r) {
+                for (int i = 0; i != 100; ++i)
+                    p[i] = x.allocate(1);
+                for (int i = 0; i != 100; ++i)
+                    x.deallocate(p[i], 1);
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+
+    ASSERT_TRUE(x.begin() == x.end());
+    std::vector<pointer> v;
+    for (int i = 0; i != 1000; ++i)
+        v.push_back(x.allocate(1));
+    ASSERT_THROW(x.allocate(1), std::bad_alloc);
+    for (pointer p : v)
+        x.deallocate(p, 1);
+}
+
+TEST(AllocatorFixture, test23) {
+    using allocator_type = Growable_Allocator<double, 1 << 16>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    ASSERT_EQ(x.chunks(), 0u);
+    ASSERT_THROW(x.allocate(1 << 13), std::bad_alloc);
+
+    // a request too big for an empty chunk maps none, a request just small enough fits
+    for (int i = 0; i != 100; ++i)
+        ASSERT_THROW(x.allocate(8064), std::bad_alloc);
+    ASSERT_EQ(x.chunks(), 0u);
+    x.deallocate(x.allocate(8063), 8063);
+    ASSERT_EQ(x.chunks(), 1u);
+
+    // a full chunk makes the heap grow instead of failing
+    std::vector<pointer> v;
+    for (int i = 0; i != 4000; ++i)
+        v.push_back(x.allocate(4));
+    ASSERT_EQ(x.chunks(), 3u);
+    ASSERT_EQ(x.released(), 0u);
+
+    for (pointer p : v)
+        x.deallocate(p, 4);
+    ASSERT_EQ(x.chunks(),   3u);
+    ASSERT_EQ(x.released(), 3u);
+    ASSERT_THROW(x.deallocate(v[0], 4), std::invalid_argument);
+
+    // a chunk given back is still mapped, and serves the next request
+    const pointer b = x.allocate(7000);
+    ASSERT_EQ(x.chunks(),   3u);
+    ASSERT_EQ(x.released(), 2u);
+    x.deallocate(b, 7000);
+
+    // a block that can't grow within its chunk moves to another, objects and all
+    pointer c = x.allocate(3000);
+    pointer d = x.allocate(3000);
+    c[0]    = 1.5;
+    c[2999] = 2.5;
+    const pointer e = x.reallocate(c, 3000, 5500);
+    ASSERT_NE(e, c);
+    ASSERT_EQ(e[0],    1.5);
+    ASSERT_EQ(e[2999], 2.5);
+    ASSERT_EQ(x.chunks(), 3u);
+    ASSERT_EQ(x.reallocate(d, 3000, 3100), d);
+    ASSERT_THROW(x.reallocate(d, 3100, 8064), std::bad_alloc);
+    ASSERT_EQ(x.chunks(), 3u);
+    x.deallocate(d, 3100);
+    x.deallocate(e, 5500);
+}
+
+TEST(AllocatorFixture, test24) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    // shrinking splits off the tail, which joins the free block after it
+    allocator_type x;
+    const pointer  b1 = x.allocate(10);
+    const pointer  b2 = x.reallocate(b1, 10, 4);
+    ASSERT_EQ(b2, b1);
+    ASSERT_EQ(x[ 0], -32);
+    ASSERT_EQ(x[40], 952);
+
+    // growing absorbs the free block after it
+    const pointer b3 = x.reallocate(b2, 4, 20);
+    ASSERT_EQ(b3, b1);
+    ASSERT_EQ(x[  0], -160);
+    ASSERT_EQ(x[168],  824);
+
+    x.deallocate(b3, 20);
+    ASSERT_EQ(x[0], 992);
+}
+
+TEST(AllocatorFixture, test25) {
+    using allocator_type = My_Allocator<string, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  b1 = x.allocate(2);
+    const pointer  b2 = x.allocate(1);
+    x.construct(b1,     "abc");
+    x.construct(b1 + 1, "def");
+
+    // no room after b1, so its objects are moved to a new block
+    const pointer b3 = x.reallocate(b1, 2, 4);
+    ASSERT_NE(b3, b1);
+    ASSERT_EQ(b3[0], "abc");
+    ASSERT_EQ(b3[1], "def");
+    ASSERT_EQ(x[0], 2 * static_cast<int>(sizeof(string)));
+
+    x.destroy(b3);
+    x.destroy(b3 + 1);
+    x.deallocate(b2, 1);
+    x.deallocate(b3, 4);
+    ASSERT_EQ(x[0], 992);
+
+    // a request that can't be met leaves the block as it was
+    const pointer b4 = x.allocate(1);
+    ASSERT_THROW(x.reallocate(b4, 1, 100), std::bad_alloc);
+    ASSERT_EQ(x[0], -static_cast<int>(sizeof(string)));
+    x.deallocate(b4, 1);
+}
+
+TEST(AllocatorFixture, test26) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using size_type      = typename allocator_type::size_type;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type  x;
+    const size_type s[4] = {1, 2, 3, 4};
+    pointer         p[4];
+    x.allocate_batch(s, p);
+    ASSERT_EQ(p[1], p[0] + 2);
+    ASSERT_EQ(p[2], p[1] + 3);
+    ASSERT_EQ(p[3], p[2] + 4);
+
+    // out of order, and next to each other, they come back as one block
+    pointer q[3] = {p[3], p[0], p[2]};
+    x.deallocate_batch(q);
+    ASSERT_EQ(q[0], p[0]);
+    ASSERT_EQ(x[ 0],   8);
+    ASSERT_EQ(x[16], -16);
+    ASSERT_EQ(x[40], 952);
+
+    pointer r[2] = {p[1], p[1]};
+    ASSERT_THROW(x.deallocate_batch(r), std::invalid_argument);
+    ASSERT_EQ(x[16], -16);
+    x.deallocate_batch(std::span<pointer>(r, 1));
+    ASSERT_EQ(x[0], 992);
+
+    // a block held by deferral is already free, and the batch is refused whole
+    x.deferral({128, 64});
+    const pointer a = x.allocate(2);
+    const pointer b = x.allocate(2);
+    const pointer c = x.allocate(2);
+    x.deallocate(a, 2);
+    pointer t[2] = {b, a};
+    ASSERT_THROW(x.deallocate_batch(t), std::invalid_argument);
+    ASSERT_EQ(x.stats().busy_blocks, 2u);
+    ASSERT_EQ(x.allocate(2), a);
+    ASSERT_NE(x.allocate(2), a);
+    ASSERT_EQ(x.capacity(c), 2u);
+}
+
+TEST(AllocatorFixture, test27) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using size_type      = typename allocator_type::size_type;
+    using pointer        = typename allocator_type::pointer;
+
+    // a batch that doesn't fit leaves nothing allocated
+    allocator_type  x;
+    const size_type s[3] = {50, 50, 50};
+    pointer         p[3];
+    ASSERT_THROW(x.allocate_batch(s, p), std::bad_alloc);
+    ASSERT_EQ(x[0], 992);
+}
+
+TEST(AllocatorFixture, test28) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    ASSERT_EQ(x.check_level(), Check::touched);
+    const pointer p = x.allocate(1);
+    Heap_Report r = x.check_heap();
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r.blocks,   2);
+    ASSERT_EQ(r.free,   976);
+
+    x[12] = -16;
+    r = x.check_heap();
+    ASSERT_FALSE(r);
+    ASSERT_STREQ(r.error, "sentinels differ");
+    ASSERT_EQ(r.index,  0);
+    ASSERT_EQ(r.blocks, 0);
+
+    // the block after the corrupt one is touched, so is the corrupt one
+    ASSERT_THROW(x.allocate(1), Heap_Error);
+    x[12] = -8;
+    ASSERT_TRUE(x.check_heap());
+    x.deallocate(p, 1);
+    ASSERT_EQ(x[0], 8);
+}
+
+TEST(AllocatorFixture, test29) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer p = x.allocate(1);
+    const pointer q = x.allocate(1);
+    x[40] = 9;
+
+    // far from the corruption, touched doesn't see it, full does
+    x.deallocate(p, 1);
+    x.check_level(Check::full);
+    try {
+        x.construct(q, 2.0);
+        FAIL();
+    }
+    catch (const Heap_Error& e) {
+        ASSERT_EQ(e.report.index, 32);
+    }
+
+    // sampled checks every third operation
+    x.check_level(Check::sampled, 3);
+    x.construct(q, 2.0);
+    x.construct(q, 2.0);
+    ASSERT_THROW(x.construct(q, 2.0), Heap_Error);
+
+    x.check_level(Check::off);
+    x.construct(q, 2.0);
+    x[40] = -1;
+    ASSERT_TRUE(x.check_heap());
+
+    // a link off a block boundary is reported, not followed
+    x[8] = 3;
+    const Heap_Report r = x.check_heap();
+    ASSERT_STREQ(r.error, "bad link to the next free block");
+    ASSERT_EQ(r.index, 0);
+    x[8] = -1;
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(AllocatorFixture, test30) {
+    using allocator_type = Recording_Allocator<My_Allocator<double, 1000>>;
+    using pointer        = typename allocator_type::pointer;
+
+    const char* path = "test_Allocator.tmp.txt";
+    {
+        Trace_Writer   trace(path);
+        allocator_type x(trace);
+        pointer p = x.allocate(1);
+        pointer q = x.allocate(3);
+        p = x.reallocate(p, 1, 2);
+        x.deallocate(q, 0);
+        x.deallocate(p, 2);
+        ASSERT_TRUE(x.heap().empty());
+    }
+    Trace_Reader in(path);
+    Trace_Record r;
+    const Trace_Record expected[5] = {
+        {0, 1,  8, 0, Trace_Record::allocate},
+        {0, 2, 24, 0, Trace_Record::allocate},
+        {0, 1, 16, 0, Trace_Record::reallocate},
+        {0, 2, 24, 0, Trace_Record::deallocate},
+        {0, 1, 16, 0, Trace_Record::deallocate}};
+    std::uint64_t time = 0;
+    for (const Trace_Record& e : expected) {
+        ASSERT_TRUE(in.next(r));
+        ASSERT_GE(r.time, time);
+        ASSERT_EQ(r.id,     e.id);
+        ASSERT_EQ(r.bytes,  e.bytes);
+        ASSERT_EQ(r.thread, e.thread);
+        ASSERT_EQ(r.op,     e.op);
+        time = r.time;
+    }
+    ASSERT_FALSE(in.next(r));
+    std::remove(path);
+    ASSERT_THROW(Trace_Reader("test_Allocator.cpp"), std::invalid_argument);
+
+    // a size that doesn't fit a record is refused, not cut short
+    {
+        Trace_Writer trace(path);
+        ASSERT_THROW(trace.write(Trace_Record::allocate, 0, std::size_t(1) << 32), std::length_error);
+        ASSERT_EQ(trace.write(Trace_Record::allocate, 0, 8), 1u);
+    }
+    std::remove(path);
+
+    // threads that share a heap, which hands an address one of them frees
+    // straight to another, still have each of their objects freed once
+    {
+        Trace_Writer trace(path);
+        Recording_Allocator<Locked_Allocator<double, 1000>> y(trace);
+        std::vector<std::thread> threads;
+        for (int t = 0; t != 4; ++t)
+            threads.emplace_back([&y] () {
+                for (int i = 0; i != 2000; ++i)
+                    y.deallocate(y.allocate(1), 1);
+            });
+        for (std::thread& t : threads)
+            t.join();
+    }
+    {
+        Trace_Reader                           in(path);
+        std::unordered_map<std::uint64_t, int> live;
+        while (in.next(r))
+            live[r.id] += (r.op == Trace_Record::allocate) ? 1 : -1;
+        ASSERT_EQ(live.size(), 8000u);
+        for (const auto& [id, n] : live)
+            ASSERT_EQ(n, 0);
+    }
+    std::remove(path);
+}
+
+TEST(AllocatorFixture, test31) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    const pointer  p = x.allocate(1);
+    const pointer  q = x.allocate(3);
+    const pointer  r = x.allocate(1);
+    x.deallocate(q, 3);
+    Heap_Stats s = x.stats();
+    ASSERT_EQ(s.live_bytes,    16u);
+    ASSERT_EQ(s.free_bytes,   952u);
+    ASSERT_EQ(s.largest_free, 928u);
+    ASSERT_EQ(s.busy_blocks,    2u);
+    ASSERT_EQ(s.free_blocks,    2u);
+    ASSERT_EQ(s.histogram[3],   1u);
+    ASSERT_EQ(s.histogram[33],  1u);
+    ASSERT_DOUBLE_EQ(s.external, 1 - 928.0 / 952);
+    ASSERT_EQ(s.allocations,    3u);
+    ASSERT_EQ(s.deallocations,  1u);
+    ASSERT_EQ(s.splits,         3u);
+    ASSERT_EQ(s.coalesces,      0u);
+
+    // 16 bytes in the 24-byte hole, too little is left to split off
+    const pointer t = x.allocate(2);
+    ASSERT_EQ(t, q);
+    s = x.stats();
+    ASSERT_EQ(s.unsplit,        8u);
+    ASSERT_EQ(s.padding,        0u);
+    ASSERT_DOUBLE_EQ(s.internal, 8.0 / 64);
+
+    x.deallocate(t, 2);
+    x.deallocate(p, 1);
+    x.deallocate(r, 1);
+    s = x.stats();
+    ASSERT_EQ(s.live_bytes,     0u);
+    ASSERT_EQ(s.free_blocks,    1u);
+    ASSERT_EQ(s.largest_free, 992u);
+    ASSERT_EQ(s.external,       0);
+    ASSERT_EQ(s.coalesces,      3u);
+
+    // a char is rounded up to the smallest block
+    My_Allocator<char, 1000> y;
+    y.allocate(1);
+    ASSERT_EQ(y.stats().padding, 7u);
+}
+
+TEST(AllocatorFixture, test32) {
+    using allocator_type = My_Allocator<int, 4000>;
+
+    // copies and rebound copies share the heap, other allocators don't
+    allocator_type             x;
+    allocator_type             y = x;
+    My_Allocator<double, 4000> z = x;
+    ASSERT_TRUE(x == y);
+    ASSERT_TRUE(x == z);
+    ASSERT_FALSE(x != z);
+    ASSERT_TRUE(x != allocator_type());
+    ASSERT_EQ(&allocator_traits<allocator_type>::select_on_container_copy_construction(x).heap(), &x.heap());
+
+    // node-based containers rebind to their nodes, and draw on one heap
+    {
+        list<int, allocator_type>                                          l(x);
+        map<int, int, less<int>, My_Allocator<pair<const int, int>, 4000>> m(x);
+        for (int i = 0; i != 10; ++i) {
+            l.push_back(i);
+            m[i] = i * i;
+        }
+        ASSERT_EQ(x.stats().busy_blocks, 20u);
+        ASSERT_EQ(m[9], 81);
+
+        // copies keep the heap of their allocator, moves and swaps take it along
+        list<int, allocator_type> c(l);
+        list<int, allocator_type> d(allocator_type{});
+        d = c;
+        ASSERT_TRUE(d.get_allocator() == x);
+        ASSERT_EQ(x.stats().busy_blocks, 40u);
+        list<int, allocator_type> e(std::move(d));
+        ASSERT_TRUE(e.get_allocator() == x);
+        ASSERT_EQ(e.size(), 10u);
+    }
+    ASSERT_TRUE(x.empty());
+
+    // a heap in static storage
+    static My_Heap<1000> h;
+    My_Allocator<double, 1000> w(h);
+    w.deallocate(w.allocate(4), 4);
+    ASSERT_EQ(h.stats().allocations, 1u);
+}
+
+TEST(AllocatorFixture, test33) {
+    using resource_type = My_Resource<1 << 16>;
+
+    // pmr containers of different types on one heap
+    resource_type x;
+    {
+        pmr::vector<int>                v(&x);
+        pmr::string                     s("a string too long for the small buffer", &x);
+        pmr::unordered_map<int, double> m(&x);
+        for (int i = 0; i != 100; ++i) {
+            v.push_back(i);
+            m[i] = i / 2.0;
+        }
+        ASSERT_EQ(v[99], 99);
+        ASSERT_EQ(m[99], 49.5);
+        ASSERT_FALSE(x.allocator().empty());
+
+        // stricter alignments than the heap's
+        void* p = x.allocate(100, 256);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(p) % 256, 0u);
+        x.deallocate(p, 100, 256);
+    }
+    ASSERT_TRUE(x.allocator().empty());
+    ASSERT_TRUE(x.allocator().check_heap());
+
+    // resources on one heap are equal, arenas only to themselves
+    resource_type y(x.allocator());
+    resource_type z(x.allocator(), Resource_Mode::arena);
+    ASSERT_TRUE(x == y);
+    ASSERT_FALSE(x == z);
+    ASSERT_TRUE(z == z);
+
+    // an arena frees all at once
+    {
+        pmr::vector<pmr::string> v(&z);
+        for (int i = 0; i != 100; ++i)
+            v.emplace_back(50, 'a' + i % 26);
+        ASSERT_EQ(v[27], pmr::string(50, 'b'));
+        void* p = z.allocate(8, 64);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(p) % 64, 0u);
+    }
+    ASSERT_GT(z.runs(), 1u);
+    ASSERT_FALSE(x.allocator().empty());
+    z.release();
+    ASSERT_EQ(z.runs(), 0u);
+    ASSERT_TRUE(x.allocator().empty());
+
+    // an arena on a corrupt heap throws on release, but not when destroyed
+    {
+        My_Resource<1 << 16, Hardened<First_Fit>> w(Resource_Mode::arena);
+        char* const p = static_cast<char*>(w.allocate(8, 8));
+        p[w.allocator().capacity(p)] = 'x';
+        ASSERT_THROW(w.release(), Heap_Error);
+        ASSERT_EQ(w.runs(), 1u);
+    }
+}
+
+TEST(AllocatorFixture, test34) {
+    using allocator_type = My_Allocator<char, 1000, Compact<First_Fit>>;
+    using pointer        = typename allocator_type::pointer;
+
+    // a busy block is its header and payload, 16 bytes for 12
+    allocator_type x;
+    ASSERT_EQ(x[0], 996);
+    const pointer p = x.allocate(12);
+    const pointer q = x.allocate(4);
+    ASSERT_EQ(x[ 0], -12);
+    ASSERT_EQ(x[16], -12);
+    ASSERT_EQ(x[32], 964);
+    ASSERT_EQ(x[996], 964);
+    ASSERT_EQ(q - p, 16);
+    ASSERT_EQ(x.capacity(p), 12u);
+
+    // a free block has a footer, and the header after it a bit
+    x.deallocate(p, 12);
+    ASSERT_EQ(x[ 0],  12);
+    ASSERT_EQ(x[12],  12);
+    ASSERT_EQ(x[16], -13);
+
+    allocator_type::iterator e = x.end();
+    ASSERT_EQ(*--e, 964);
+    ASSERT_EQ(*--e, -13);
+    ASSERT_EQ(*--e,  12);
+    ASSERT_EQ(e, x.begin());
+    ASSERT_TRUE(x.check_heap());
+
+    x[16] = -12;
+    ASSERT_STREQ(x.check_heap().error, "free bit of the block before out of date");
+    x[16] = -13;
+
+    // coalescing both ways clears the bit
+    x.deallocate(q, 4);
+    ASSERT_EQ(x[0], 996);
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(AllocatorFixture, test35) {
+    // random requests on the compact layout, checking every block after each
+    auto churn = [] (auto x) {
+        x.check_level(Check::full);
+        vector<pair<double*, size_t>> busy;
+        uint64_t r = 42;
+        for (int k = 0; k != 2000; ++k) {
+            r = r * 6364136223846793005u + 1442695040888963407u;
+            const size_t n = 1 + (r >> 33) % 24;
+            if (busy.empty() || ((r >> 60) < 9)) {
+                try {
+                    busy.emplace_back(x.allocate(n), n);
+                }
+                catch (const std::bad_alloc&) {}
+            }
+            else if ((r >> 60) < 12) {
+                auto& b = busy[(r >> 20) % busy.size()];
+                try {
+                    b = {x.reallocate(b.first, b.second, n), n};
+                }
+                catch (const std::bad_alloc&) {}
+            }
+            else {
+                const size_t i = (r >> 20) % busy.size();
+                x.deallocate(busy[i].first, busy[i].second);
+                busy.erase(busy.begin() + i);
+            }
+        }
+        for (const auto& b : busy)
+            x.deallocate(b.first, b.second);
+        x.consolidate();
+        return x.empty();
+    };
+    ASSERT_TRUE(churn(My_Allocator<double, 4000, Compact<First_Fit>>()));
+    ASSERT_TRUE(churn(My_Allocator<double, 4000, Compact<Next_Fit>>()));
+    ASSERT_TRUE(churn(My_Allocator<double, 4000, Compact<Best_Fit>>()));
+    ASSERT_TRUE(churn(My_Allocator<double, 4000, Compact<First_Fit>, 32>()));
+
+    // and holding freed blocks, see test36
+    My_Allocator<double, 4000>                    d;
+    My_Allocator<double, 4000, Compact<Best_Fit>> e;
+    d.deferral({128, 8});
+    e.deferral({128, 8});
+    ASSERT_TRUE(churn(d));
+    ASSERT_TRUE(churn(e));
+
+    // and hardened, see test37
+    My_Allocator<double, 4000, Hardened<Compact<Best_Fit>>> h;
+    h.deferral({128, 8});
+    ASSERT_TRUE(churn(My_Allocator<double, 4000, Hardened<First_Fit>>()));
+    ASSERT_TRUE(churn(My_Allocator<double, 4000, Compact<Hardened<Next_Fit, 4>>, 16>()));
+    ASSERT_TRUE(churn(My_Allocator<double, 4000, Hardened<First_Fit, 0>>()));
+    ASSERT_TRUE(churn(h));
+
+    // and on wide sentinels, see test38
+    ASSERT_TRUE(churn(My_Allocator<double, 8000, Wide<First_Fit>>()));
+    ASSERT_TRUE(churn(My_Allocator<double, 8000, Compact<Wide<Best_Fit>>>()));
+    ASSERT_TRUE(churn(My_Allocator<double, 8000, Hardened<Wide<Compact<Next_Fit>>>, 32>()));
+}
+
+TEST(AllocatorFixture, test36) {
+    using allocator_type = My_Allocator<double, 1000>;
+    using pointer        = typename allocator_type::pointer;
+
+    allocator_type x;
+    x.deferral({32, 2});
+    const pointer p = x.allocate(1);
+    const pointer q = x.allocate(1);
+    const pointer r = x.allocate(8);
+
+    // a small block is held busy, without coalescing, and reused first
+    x.deallocate(p, 1);
+    ASSERT_EQ(x[0], -8);
+    ASSERT_THROW(x.deallocate(p, 1), std::invalid_argument);
+    Heap_Stats s = x.stats();
+    ASSERT_EQ(s.held_blocks, 1u);
+    ASSERT_EQ(s.held_bytes,  8u);
+    ASSERT_EQ(s.live_bytes, 72u);
+    ASSERT_EQ(x.allocate(1), p);
+    ASSERT_TRUE(x.check_heap());
+
+    // a large block is coalesced at once
+    x.deallocate(r, 8);
+    ASSERT_EQ(x[32], 960);
+
+    // more than hold held blocks are coalesced, and all once none is busy
+    const pointer k = x.allocate(4);
+    x.deallocate(p, 1);
+    x.deallocate(q, 1);
+    ASSERT_EQ(x.stats().held_blocks, 2u);
+    ASSERT_EQ(x.allocate(1), q);
+    x.deallocate(q, 1);
+    const pointer u = x.allocate(2);
+    const pointer v = x.allocate(2);
+    x.deallocate(u, 2);
+    ASSERT_EQ(x.stats().held_blocks,    0u);
+    ASSERT_EQ(x.stats().consolidations, 1u);
+    x.deallocate(v, 2);
+    x.deallocate(k, 4);
+    ASSERT_EQ(x.stats().consolidations, 2u);
+    ASSERT_TRUE(x.empty());
+
+    // a request that doesn't fit otherwise coalesces them
+    const pointer w = x.allocate(1);
+    const pointer y = x.allocate(1);
+    const pointer z = x.allocate(120);
+    x.deallocate(w, 1);
+    x.deallocate(y, 1);
+    ASSERT_EQ(x.stats().held_blocks, 2u);
+    ASSERT_EQ(x.allocate(3), w);
+    ASSERT_EQ(x.stats().consolidations, 3u);
+    ASSERT_TRUE(x.check_heap());
+    x.deferral({});
+    ASSERT_EQ(x.deferral().largest, 0u);
+    x.deallocate(w, 3);
+    x.deallocate(z, 120);
+    ASSERT_TRUE(x.empty());
+
+    // a held block freed again is caught, wherever it is on its quick list
+    x.deferral({128, 64});
+    const pointer a = x.allocate(2);
+    const pointer b = x.allocate(2);
+    const pointer c = x.allocate(2); // keeps the heap from emptying
+    x.deallocate(a, 2);
+    x.deallocate(b, 2);
+    ASSERT_THROW(x.deallocate(a, 2), std::invalid_argument);
+    ASSERT_EQ(x.stats().held_blocks, 2u);
+    ASSERT_TRUE(x.check_heap());
+    ASSERT_EQ(x.allocate(2), b);
+    ASSERT_EQ(x.allocate(2), a);
+    ASSERT_NE(x.allocate(2), a);
+    ASSERT_EQ(x.capacity(c), 2u);
+}
+
+TEST(AllocatorFixture, test37) {
+    using allocator_type = My_Allocator<double, 1000, Hardened<First_Fit, 2>>;
+    using pointer        = typename allocator_type::pointer;
+
+    // a block has room for a canary after its objects
+    allocator_type x;
+    const pointer p = x.allocate(1);
+    const pointer q = x.allocate(1);
+    const pointer r = x.allocate(1);
+    ASSERT_EQ(x[0], -16);
+    ASSERT_EQ(x.capacity(p), 1u);
+
+    // a freed block is poisoned and quarantined, not reused
+    x.deallocate(p, 1);
+    ASSERT_EQ(x[0], -16);
+    ASSERT_EQ(reinterpret_cast<const unsigned char*>(p)[0], 0xDB);
+    ASSERT_EQ(x.stats().held_blocks, 1u);
+    ASSERT_THROW(x.deallocate(p, 1), std::invalid_argument);
+    const pointer s = x.allocate(1);
+    ASSERT_EQ(s, r + 3);
+
+    // until more blocks than fit in the quarantine are freed after it
+    x.deallocate(q, 1);
+    x.deallocate(s, 1);
+    ASSERT_EQ(x[0], 16);
+    ASSERT_EQ(x.stats().held_blocks, 2u);
+    ASSERT_TRUE(x.check_heap());
+
+    // a write after free is found when the block leaves the quarantine
+    q[0] = 2.0;
+    ASSERT_STREQ(x.check_heap().error, "block written after it was freed");
+    const pointer t = x.allocate(1);
+    ASSERT_EQ(t, p);
+    ASSERT_THROW(x.deallocate(t, 1), Heap_Error);
+    std::memset(q, 0xDB, sizeof(double));
+    x.deallocate(t, 1);
+    ASSERT_TRUE(x.check_heap());
+
+    // an overrun is found when the block is freed, or by a patrol
+    const pointer u = x.allocate(1);
+    const double  c = u[1];
+    u[1] = 3.0;
+    try {
+        x.deallocate(u, 1);
+        FAIL();
+    }
+    catch (const Heap_Error& e) {
+        ASSERT_STREQ(e.report.error, "canary overwritten");
+        ASSERT_EQ(e.report.index, 24);
+    }
+    ASSERT_THROW(x.patrol(8), Heap_Error);
+    u[1] = c;
+    x.patrol(8);
+
+    x.deallocate(u, 1);
+    x.deallocate(r, 1);
+    x.consolidate();
+    ASSERT_TRUE(x.empty());
+
+    // a batch goes through the quarantine too, and a write after it is found
+    pointer v[3] = {x.allocate(1), x.allocate(1), x.allocate(1)};
+    const pointer w = v[0];
+    x.deallocate_batch(v);
+    ASSERT_EQ(x.stats().held_blocks, 2u);
+    ASSERT_EQ(reinterpret_cast<const unsigned char*>(v[2])[0], 0xDB);
+    v[2][0] = 4.0;
+    ASSERT_THROW(x.consolidate(), Heap_Error);
+    std::memset(v[2], 0xDB, sizeof(double));
+    x.consolidate();
+    ASSERT_TRUE(x.empty());
+
+    // and a batch that would push out a block written after it was freed frees nothing
+    pointer y[2] = {x.allocate(1), x.allocate(1)};
+    ASSERT_EQ(y[0], w);
+    pointer z[1] = {x.allocate(1)};
+    x.deallocate_batch(y);
+    y[0][0] = 5.0;
+    ASSERT_THROW(x.deallocate_batch(z), Heap_Error);
+    ASSERT_EQ(x.stats().busy_blocks, 1u);
+    std::memset(y[0], 0xDB, sizeof(double));
+    x.deallocate_batch(z);
+    x.consolidate();
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(AllocatorFixture, test38) {
+    // wide sentinels are 8 bytes, and so are the links of a free block
+    using allocator_type = My_Allocator<double, 1000, Wide<First_Fit>>;
+    allocator_type x;
+    ASSERT_EQ(x[0], 984);
+    double* const p = x.allocate(1);
+    ASSERT_EQ(x[0],  -16);
+    ASSERT_EQ(x[24], -16);
+    ASSERT_EQ(x[32], 952);
+    ASSERT_EQ(allocator_type::block_of(1), 16);
+    x.deallocate(p, 1);
+    ASSERT_TRUE(x.empty());
+
+    // a heap of more than 2 GiB, whose blocks past 2 GiB have indices that
+    // don't fit in an int
+    using heap_type = My_Heap<(std::size_t(3) << 30), Wide<First_Fit>>;
+    static_assert(std::is_same_v<heap_type::tag_type, std::int64_t>);
+    const auto h = std::make_unique<heap_type>();
+    const std::size_t n = std::size_t(5) << 28;
+    char* const a = h->allocate(n);
+    char* const b = h->allocate(n);
+    char* const c = h->allocate(n / 5);
+    ASSERT_EQ(b - a, static_cast<std::ptrdiff_t>(n + 16));
+    ASSERT_EQ(c - b, static_cast<std::ptrdiff_t>(n + 16));
+    ASSERT_EQ(h->capacity(c), n / 5);
+    std::vector<std::int64_t> sentinels;
+    for (auto it = h->begin(); it != h->end(); ++it)
+        sentinels.push_back(*it);
+    ASSERT_EQ(sentinels.size(), 4u);
+    ASSERT_EQ(sentinels[2], -static_cast<std::int64_t>(n / 5));
+    ASSERT_GT(static_cast<std::size_t>(c - a), std::size_t(INT32_MAX));
+    h->deallocate(b, n);
+    ASSERT_EQ(h->stats().largest_free, n);
+    ASSERT_TRUE(h->check_heap());
+    h->deallocate(a, n);
+    h->deallocate(c, n / 5);
+    ASSERT_TRUE(h->empty());
+    ASSERT_EQ(h->stats().free_bytes, (std::size_t(3) << 30) - 16);
+}
+
+TEST(AllocatorFixture, test39) {
+    // a saved heap loads into another with every object at the same offset
+    using allocator_type = My_Allocator<double, 1000>;
+    const char* path = "test_Allocator.tmp.heap";
+    allocator_type x;
+    double* const p = x.allocate(3);
+    double* const q = x.allocate(5);
+    p[0] = 2.5;
+    q[4] = 7.5;
+    x.deallocate(p, 3);
+    x.root(x.offset_of(q));
+    x.save(path);
+    allocator_type y;
+    y.load(path);
+    ASSERT_TRUE(y.check_heap());
+    ASSERT_EQ(y.root(), x.root());
+    double* const r = y.at(y.root());
+    ASSERT_EQ(r[4], 7.5);
+    ASSERT_EQ(y.capacity(r), 5u);
+    ASSERT_EQ(y[0], x[0]);
+    y.deallocate(r, 5);
+    ASSERT_TRUE(y.empty());
+
+    // a heap of another type, or whose bytes changed, doesn't load
+    My_Allocator<double, 2000> z;
+    ASSERT_THROW(z.load(path), std::invalid_argument);
+    {
+        std::FILE* f = std::fopen(path, "r+b");
+        std::fseek(f, 100, SEEK_SET);
+        std::fputc(0x5A, f);
+        std::fclose(f);
+    }
+    ASSERT_THROW(y.load(path), std::invalid_argument);
+    ASSERT_TRUE(y.empty());
+    std::remove(path);
+
+    // a mapped heap is found again in its file, and can be loaded from it
+    {
+        allocator_type m(path);
+        ASSERT_TRUE(m.empty());
+        double* const s = m.allocate(4);
+        s[3] = 1.25;
+        m.root(m.offset_of(s));
+    }
+    {
+        allocator_type m(path);
+        double* const s = m.at(m.root());
+        ASSERT_EQ(s[3], 1.25);
+        ASSERT_EQ(m.stats().busy_blocks, 1u);
+        ASSERT_THROW(allocator_type{path}, std::runtime_error); // while m has it mapped
+        y.load(path);
+        ASSERT_EQ(y.at(y.root())[3], 1.25);
+    }
+
+    // one never unmapped has its blocks checked instead
+    {
+        std::FILE* f = std::fopen(path, "r+b");
+        const std::uint32_t dirty = 0;
+        std::fseek(f, 12, SEEK_SET);
+        std::fwrite(&dirty, sizeof(dirty), 1, f);
+        const int sentinel = 12345;
+        std::fseek(f, 44, SEEK_SET); // the first block's header, after the header of the file and pad
+        std::fwrite(&sentinel, sizeof(sentinel), 1, f);
+        std::fclose(f);
+    }
+    ASSERT_THROW(allocator_type m(path), Heap_Error);
+    std::remove(path);
+}
+
+TEST(AllocatorFixture, test40) {
+    // an offset_ptr keeps the distance to its object, wherever it is copied
+    double a[4] = {1, 2, 3, 4};
+    offset_ptr<double> p = a;
+    offset_ptr<double> q = p + 3;
+    ASSERT_EQ(*q, 4);
+    ASSERT_EQ(q - p, 3);
+    ASSERT_TRUE(p < q);
+    ASSERT_EQ(p[1], 2);
+    ASSERT_FALSE(offset_ptr<double>());
+    ASSERT_TRUE(offset_ptr<double>() == nullptr);
+    const offset_ptr<void>  v = q;
+    ASSERT_EQ(static_cast<offset_ptr<double>>(v).get(), a + 3);
+    ASSERT_EQ(std::pointer_traits<offset_ptr<double>>::pointer_to(a[2]).get(), a + 2);
+
+#ifdef __linux__
+    // a heap shared by processes: the child attaches on its own and finds
+    // what the parent allocated, the parent what the child did
+    using allocator_type = Shm_Allocator<double, 4096>;
+    const std::string name = "/test_Allocator." + std::to_string(getpid());
+    allocator_type x(name.c_str());
+    allocator_type y(name.c_str());
+    ASSERT_TRUE(x != y);
+    const allocator_type::pointer r = x.allocate(2);
+    r[1] = 0.5;
+    x.root(x.offset_of(r.get()));
+    ASSERT_EQ(y.at(y.root())[1], 0.5);
+    ASSERT_NE(y.at(y.root()).get(), r.get());
+    const pid_t child = fork();
+    if (child == 0) {
+        allocator_type z(name.c_str());
+        const allocator_type::pointer s = z.allocate(3);
+        s[0] = z.at(z.root())[1] * 4;
+        z.root(z.offset_of(s.get()));
+        std::_Exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    ASSERT_EQ(x.at(x.root())[0], 2);
+    ASSERT_EQ(x.stats().busy_blocks, 2u);
+    y.deallocate(y.at(y.root()), 3);
+    x.deallocate(r, 2);
+    ASSERT_TRUE(x.locked([] (allocator_type::heap_type& h) {return h.empty();}));
+
+    // a process that dies holding the mutex is recovered from, if it
+    // left the heap intact, and otherwise the heap is lost
+    if (fork() == 0) {
+        x.locked([] (allocator_type::heap_type&) {std::_Exit(0);});
+    }
+    wait(&status);
+    x.deallocate(x.allocate(1), 1);
+    ASSERT_EQ(x.recoveries(), 1u);
+    if (fork() == 0) {
+        x.locked([] (allocator_type::heap_type& h) {h[0] = 12345; std::_Exit(0);});
+    }
+    wait(&status);
+    ASSERT_THROW(x.allocate(1), Heap_Error);
+    ASSERT_THROW(x.allocate(1), std::runtime_error);
+    ASSERT_TRUE(allocator_type::unlink(name.c_str()));
+    ASSERT_FALSE(allocator_type::unlink(name.c_str()));
+#endif
+}
+
+TEST(AllocatorFixture, test41) {
+    // a vector that is itself in a relocatable heap, with its elements,
+    // is found whole in another heap the first is loaded into, and grows there
+    using heap_type      = My_Heap<4096, Relocatable<First_Fit>>;
+    using allocator_type = My_Allocator<double, 4096, Relocatable<First_Fit>>;
+    using vector_type    = std::vector<double, allocator_type>;
+    static_assert(std::is_same_v<allocator_traits<allocator_type>::pointer, offset_ptr<double>>);
+    const char* path = "test_Allocator.tmp.heap";
+    const auto  h    = std::make_unique<heap_type>();
+    {
+        allocator_type x(*h);
+        My_Allocator<vector_type, 4096, Relocatable<First_Fit>> y(x);
+        vector_type* const v = y.allocate(1).get();
+        new (v) vector_type(x);
+        for (int i = 0; i != 10; ++i)
+            v->push_back(i);
+        h->root(h->offset_of(v));
+        h->save(path);
+    }
+    const auto g = std::make_unique<heap_type>();
+    g->load(path);
+    std::remove(path);
+    h->at<vector_type>(h->root())->clear();
+    vector_type& w = *g->at<vector_type>(g->root());
+    ASSERT_EQ(w.size(), 10u);
+    ASSERT_EQ(w[7], 7);
+    const char* const b = reinterpret_cast<const char*>(g.get());
+    const char* const d = reinterpret_cast<const char*>(w.data());
+    ASSERT_TRUE((b < d) && (d < b + sizeof(heap_type)));
+    ASSERT_TRUE(w.get_allocator() == allocator_type(*g));
+    w.push_back(10);
+    ASSERT_EQ(w.back(), 10);
+    double sum = 0;
+    for (const double d : w)
+        sum += d;
+    ASSERT_EQ(sum, 55);
+    w.~vector_type();
+    My_Allocator<vector_type, 4096, Relocatable<First_Fit>>(*g).deallocate(&w, 1);
+    ASSERT_TRUE(g->empty());
+}